@@ -0,0 +1,600 @@
+// Eternal Horror
+// Copyright(C) 2020 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// Frame time benchmark for the host build. Every level is loaded, driven by
+// the key script for the requested number of frames and timed around
+// Update() and Render(). The hash column is an FNV-1a of every rendered page
+// and the OAM it is shown with, so two builds that draw the same frames print
+// the same hash. Built with PROFILER=1 it also prints the per-stage CSV of
+// profile.h to stderr. -t runs the timedemo of timedemo.h instead, which
+// prints its CSV to stderr. -k records the draw kernel calls Render() makes
+// while the script plays every level, then times each specialized variant
+// against the generic kernel on the calls it was picked for, see kernels.h.
+// Its rect rows time the blit layer's FillRect against the old DrawRect loop
+// in each screen state. -r renders two thirds or half of the view's columns
+// throughout (80 or 60 of the default 120), as dynamic resolution does when
+// frames run long, and -i interlaces the columns as INTERLACED_COLUMNS does.
+// -w writes how many wall columns the script drew at each height, at
+// VIEW_SCALE 2, as the profile tools/mkscalers.c picks scaler heights by.
+
+#include <gba_video.h>
+#include <gba_input.h>
+#include <gba_sprites.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "demo.h"
+#include "host.h"
+#include "hud.h"
+#include "kernels.h"
+#include "profile.h"
+#include "timedemo.h"
+
+static const char *defaultScript =
+	"64 LEFT\n"
+	"30 UP\n"
+	"32 RIGHT\n"
+	"30 UP+L\n"
+	"64 RIGHT\n"
+	"30 DOWN\n"
+	"20 A\n"
+	"30 UP+R\n";
+
+static uint64_t Now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int CompareTimes(const void *a, const void *b)
+{
+	uint64_t ta = *(const uint64_t *) a;
+	uint64_t tb = *(const uint64_t *) b;
+	return ta < tb ? -1 : ta > tb;
+}
+
+static uint32_t HashPage(uint32_t hash, uint32_t renderPage)
+{
+	const uint8_t *p = (const uint8_t *) &hostVram[PAGE_BITMAP(renderPage) ? 0x5000 : 0];
+	
+	for (uint32_t i = 0; i < ROW_STRIDE * 2 * PAGE_ROWS; i++)
+		hash = (hash ^ p[i]) * 16777619;
+	
+	// and the OBJs over it, see hud.h
+	p = (const uint8_t *) hostOam;
+	
+	for (uint32_t i = 0; i < sizeof(hostOam); i++)
+		hash = (hash ^ p[i]) * 16777619;
+	
+	return hash;
+}
+
+// The 256 colour OBJ index at a screen pixel, 0 where no OBJ covers it. Only
+// what the HUD uses is drawn: regular OBJs, one dimensional tile mapping and
+// every OBJ in front of BG2, the first in OAM in front of the rest.
+static uint32_t ObjPixel(int32_t x, int32_t y)
+{
+	static const uint8_t sizes[3][4][2] =
+	{
+		{ { 8, 8 }, { 16, 16 }, { 32, 32 }, { 64, 64 } },
+		{ { 16, 8 }, { 32, 8 }, { 32, 16 }, { 64, 32 } },
+		{ { 8, 16 }, { 8, 32 }, { 16, 32 }, { 32, 64 } }
+	};
+	
+	if (!(REG_DISPCNT & OBJ_ON))
+		return 0;
+	
+	const uint8_t *tiles = (const uint8_t *) OBJ_BASE_ADR;
+	
+	for (uint32_t i = 0; i < 128; i++)
+	{
+		const OBJATTR *obj = &hostOam[i];
+		
+		if ((obj->attr0 & (3 << 8)) != ATTR0_NORMAL || (obj->attr0 >> 14) == 3)
+			continue;
+		
+		const uint8_t *size = sizes[obj->attr0 >> 14][obj->attr1 >> 14];
+		int32_t ox = x - (obj->attr1 & 0x1FF);
+		int32_t oy = y - (obj->attr0 & 0xFF);
+		
+		if (ox < 0)
+			ox += 512;
+		
+		if (oy < 0)
+			oy += 256;
+		
+		if (ox >= size[0] || oy >= size[1])
+			continue;
+		
+		uint32_t tile = (oy >> 3) * (size[0] >> 3) + (ox >> 3);
+		uint32_t index = tiles[(obj->attr2 & 0x3FF) * 32 + tile * 64 + (oy & 7) * 8 + (ox & 7)];
+		
+		if (index)
+			return index;
+	}
+	
+	return 0;
+}
+
+// The layers window 0 shows at x, y: WININ inside its rectangle, WINOUT
+// outside, every layer when it is off
+static uint32_t WindowLayers(int32_t x, int32_t y)
+{
+	if (!(REG_DISPCNT & WIN0_ON))
+		return 0x3F;
+	
+	if (x >= (REG_WIN0H >> 8) && x < (REG_WIN0H & 0xFF) && y >= (REG_WIN0V >> 8) && y < (REG_WIN0V & 0xFF))
+		return REG_WININ & 0x3F;
+	
+	return REG_WINOUT & 0x3F;
+}
+
+// The screen as BG2 and the OBJs show it: the page's mode 4 or mode 5 bitmap
+// read through the affine registers, with the backdrop colour outside of it
+// or of window 0
+static uint16_t ScreenPixel(uint32_t renderPage, int32_t x, int32_t y)
+{
+	uint32_t layers = WindowLayers(x, y);
+	uint32_t obj = layers & BIT(4) ? ObjPixel(x, y) : 0;
+	
+	if (obj)
+		return OBJ_COLORS[obj];
+	
+	if (!(layers & BIT(2)))
+		return BG_COLORS[0];
+	
+	const uint16_t *vram = &hostVram[PAGE_BITMAP(renderPage) ? 0x5000 : 0];
+	int32_t bx = (REG_BG2X + REG_BG2PA * x + REG_BG2PB * y) >> 8;
+	int32_t by = (REG_BG2Y + REG_BG2PC * x + REG_BG2PD * y) >> 8;
+	
+	if ((REG_DISPCNT & 7) == MODE_5)
+	{
+		if (bx < 0 || bx >= 160 || by < 0 || by >= 128)
+			return BG_COLORS[0];
+		
+		return vram[by * 160 + bx];
+	}
+	
+	if (bx < 0 || bx >= SCREEN_WIDTH || by < 0 || by >= SCREEN_HEIGHT)
+		return BG_COLORS[0];
+	
+	return BG_COLORS[((const uint8_t *) vram)[by * SCREEN_WIDTH + bx]];
+}
+
+static void WritePage(const char *prefix, uint32_t currentLevel, uint32_t renderPage)
+{
+	char path[4096];
+	snprintf(path, sizeof(path), "%s%u.ppm", prefix, currentLevel);
+	FILE *file = fopen(path, "wb");
+	
+	if (!file)
+	{
+		perror(path);
+		return;
+	}
+	
+	fprintf(file, "P6\n%d %d\n255\n", SCREEN_WIDTH, SCREEN_HEIGHT);
+	
+	for (int32_t y = 0; y < SCREEN_HEIGHT; y++)
+	{
+		for (int32_t x = 0; x < SCREEN_WIDTH; x++)
+		{
+			uint16_t color = ScreenPixel(renderPage, x, y);
+			uint8_t rgb[3] = { (color & 31) << 3, ((color >> 5) & 31) << 3, ((color >> 10) & 31) << 3 };
+			fwrite(rgb, 1, 3, file);
+		}
+	}
+	
+	fclose(file);
+}
+
+#define MAX_KERNEL_CALLS (1 << 20)
+
+static const char *kernelNames[4] = { "wall slice", "sprite", "graphic", "rect" };
+static const char *variantNames[4][6] =
+{
+	{ "fit", "clip", "fit wide", "clip wide" },
+	{ "fit", "fit damage", "clip", "clip damage" },
+	{ "opaque", "keyed" },
+	{ "dying", "game", "title", "dead", "end", "credits" }
+};
+
+static void CallGeneric(const kernelcall_t *call)
+{
+	const int32_t *a = call->args;
+	
+	if (call->kernel == KERNEL_WALL_SLICE)
+	{
+		// a wide slice the way full resolution draws it, as two
+		DrawWallSlice(call->data, a[0], a[1], a[2], a[3]);
+		
+		if (call->variant & 2)
+			DrawWallSlice(call->data, a[0], a[1] + 1, a[2], a[3]);
+	}
+	else if (call->kernel == KERNEL_SPRITE)
+		DrawSprite(a[0], a[1], a[2], a[3], a[4], call->variant & 1);
+	else if (call->kernel == KERNEL_RECT)
+		DrawRect(a[0], a[1], a[2], a[3], a[4]);
+	else
+		DrawGraphic(call->data, a[0], a[1], a[2], a[3], a[4], a[5]);
+}
+
+static void CallVariant(const kernelcall_t *call)
+{
+	const int32_t *a = call->args;
+	
+	if (call->kernel == KERNEL_WALL_SLICE)
+	{
+		if (call->variant == 3)
+			DrawWallSliceClipWide(call->data, a[0], a[1], a[2], a[3]);
+		else if (call->variant == 2)
+			DrawWallSliceFitWide(call->data, a[0], a[1], a[2], a[3]);
+		else if (call->variant)
+			DrawWallSliceClip(call->data, a[0], a[1], a[2], a[3]);
+		else
+			DrawWallSliceFit(call->data, a[0], a[1], a[2], a[3]);
+	}
+	else if (call->kernel == KERNEL_SPRITE)
+		spriteKernels[call->variant >> 1][call->variant & 1](a[0], a[1], a[2], a[3], a[4]);
+	else if (call->kernel == KERNEL_RECT)
+		FillRect(a[0], a[1], a[2], a[3], a[4]);
+	else if (call->variant)
+		DrawGraphicKeyed(call->data, a[0], a[1], a[2], a[3], a[4], a[5]);
+	else
+		DrawGraphicOpaque(call->data, a[0], a[1], a[2], a[3], a[4], a[5]);
+}
+
+// Draws every call of one kernel variant with the generic kernel or the
+// variant into cleared VRAM and returns the best time of a pass in ns
+static uint64_t TimeCalls(const kernelcall_t *calls, uint32_t numCalls, uint32_t variant)
+{
+	uint64_t best = UINT64_MAX;
+	
+	for (uint32_t pass = 0; pass < 16; pass++)
+	{
+		memset(hostVram, 0, sizeof(hostVram));
+		
+		uint64_t t0 = Now();
+		
+		for (uint32_t i = 0; i < numCalls; i++)
+		{
+			page = calls[i].page;
+			
+			if (variant)
+				CallVariant(&calls[i]);
+			else
+				CallGeneric(&calls[i]);
+		}
+		
+		uint64_t t1 = Now();
+		
+		if (t1 - t0 < best)
+			best = t1 - t0;
+	}
+	
+	return best;
+}
+
+static void BenchKernelVariants(uint32_t numFrames, uint32_t onlyLevel)
+{
+	kernelCallLimit = MAX_KERNEL_CALLS;
+	kernelCalls = malloc(kernelCallLimit * sizeof(kernelcall_t));
+	
+	for (uint32_t benchLevel = 1; benchLevel <= numLevels; benchLevel++)
+	{
+		if (onlyLevel && benchLevel != onlyLevel)
+			continue;
+		
+		level = benchLevel;
+		LoadLevel();
+		state = 1;
+		health = 100;
+		HostRewindScript();
+		
+		// the second half with the solid ceiling and floor
+		for (uint32_t i = 0; i < numFrames; i++)
+		{
+			solidPlanes = i >= numFrames / 2;
+			ReadInput();
+			Update();
+			Render();
+			FlipPage();
+		}
+	}
+	
+	solidPlanes = 0;
+	
+	// the blood wipe, then the title, death, end and credits screens
+	state = 0;
+	health = 0;
+	
+	while (state == 0)
+	{
+		Update();
+		Render();
+		FlipPage();
+	}
+	
+	for (state = 2; state <= 5; state++)
+		Render();
+	
+	uint32_t numCalls = kernelCallCount;
+	kernelCallLimit = 0;
+	
+	if (numCalls == MAX_KERNEL_CALLS)
+		fprintf(stderr, "only the first %u kernel calls were recorded\n", numCalls);
+	
+	// every column visible, so sprites draw in full with either kernel
+	for (uint32_t i = 0; i < VIEW_WIDTH; i++)
+		zBuffer[i] = INT32_MAX;
+	
+	static uint16_t generic[sizeof(hostVram) / sizeof(uint16_t)];
+	kernelcall_t *calls = malloc(numCalls * sizeof(kernelcall_t));
+	
+	printf("kernel,variant,calls,generic_ns,variant_ns,speedup,match\n");
+	
+	for (uint32_t kernel = 0; kernel < 4; kernel++)
+	{
+		for (uint32_t variant = 0; variant < 6 && variantNames[kernel][variant]; variant++)
+		{
+			uint32_t count = 0;
+			
+			for (uint32_t i = 0; i < numCalls; i++)
+			{
+				if (kernelCalls[i].kernel == kernel && kernelCalls[i].variant == variant)
+					calls[count++] = kernelCalls[i];
+			}
+			
+			if (count == 0)
+				continue;
+			
+			uint64_t genericTime = TimeCalls(calls, count, 0);
+			memcpy(generic, hostVram, sizeof(generic));
+			uint64_t variantTime = TimeCalls(calls, count, 1);
+			uint32_t match = memcmp(generic, hostVram, sizeof(generic)) == 0;
+			
+			printf("%s,%s,%u,%.1f,%.1f,%.2f,%s\n", kernelNames[kernel], variantNames[kernel][variant], count,
+				(double) genericTime / count, (double) variantTime / count,
+				(double) genericTime / variantTime, match ? "yes" : "no");
+		}
+	}
+	
+	free(calls);
+	free(kernelCalls);
+	kernelCalls = NULL;
+	kernelCallCount = 0;
+}
+
+// Plays the script on every level and writes the columns drawn by the
+// compiled scalers or DrawWallColumn, the wall slices one view column wide,
+// per height
+static int WriteWallHeights(const char *path, uint32_t numFrames, uint32_t onlyLevel)
+{
+	static uint64_t columns[MAX_HEIGHT / 2 + 1];
+	FILE *file = fopen(path, "w");
+	
+	if (!file)
+		return 0;
+	
+	kernelCallLimit = MAX_KERNEL_CALLS;
+	kernelCalls = malloc(kernelCallLimit * sizeof(kernelcall_t));
+	
+	for (uint32_t benchLevel = 1; benchLevel <= numLevels; benchLevel++)
+	{
+		if (onlyLevel && benchLevel != onlyLevel)
+			continue;
+		
+		level = benchLevel;
+		LoadLevel();
+		state = 1;
+		health = 100;
+		HostRewindScript();
+		
+		for (uint32_t i = 0; i < numFrames; i++)
+		{
+			kernelCallCount = 0;
+			ReadInput();
+			Update();
+			Render();
+			FlipPage();
+			
+			for (uint32_t j = 0; j < kernelCallCount; j++)
+			{
+				uint32_t height = (kernelCalls[j].args[3] >> PROJECTION_SHIFT) & ~1u;
+				
+				if (kernelCalls[j].kernel == KERNEL_WALL_SLICE && !(kernelCalls[j].variant & 2))
+					columns[(height < 2 ? 2 : height) >> 1]++;
+			}
+		}
+	}
+	
+	free(kernelCalls);
+	kernelCalls = NULL;
+	kernelCallCount = 0;
+	kernelCallLimit = 0;
+	
+	fprintf(file, "# Wall columns drawn per height at VIEW_SCALE 2, written by ./bench -w\n");
+	fprintf(file, "# from %u frames of the key script on every level\n", numFrames);
+	
+	for (uint32_t height = 2; height <= MAX_HEIGHT >> PROJECTION_SHIFT; height += 2)
+	{
+		if (columns[height >> 1])
+			fprintf(file, "%u %llu\n", height, (unsigned long long) columns[height >> 1]);
+	}
+	
+	fclose(file);
+	return 1;
+}
+
+static void Usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-n frames] [-l level] [-s script] [-p ppm-prefix] [-r columns] [-w heights] [-i] [-t] [-k]\n", name);
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t numFrames = 1000;
+	uint32_t onlyLevel = 0;
+	const char *scriptPath = NULL;
+	const char *ppmPrefix = NULL;
+	const char *heightsPath = NULL;
+	uint32_t timedemo = 0;
+	uint32_t kernels = 0;
+	uint32_t columns = VIEW_WIDTH;
+	
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-t") == 0)
+		{
+			timedemo = 1;
+			continue;
+		}
+		
+		if (strcmp(argv[i], "-k") == 0)
+		{
+			kernels = 1;
+			continue;
+		}
+		
+		if (strcmp(argv[i], "-i") == 0)
+		{
+			interlaceColumns = 1;
+			continue;
+		}
+		
+		if (i + 1 >= argc)
+			Usage(argv[0]);
+		
+		if (strcmp(argv[i], "-n") == 0)
+			numFrames = strtoul(argv[++i], NULL, 0);
+		else if (strcmp(argv[i], "-l") == 0)
+			onlyLevel = strtoul(argv[++i], NULL, 0);
+		else if (strcmp(argv[i], "-s") == 0)
+			scriptPath = argv[++i];
+		else if (strcmp(argv[i], "-p") == 0)
+			ppmPrefix = argv[++i];
+		else if (strcmp(argv[i], "-r") == 0)
+			columns = strtoul(argv[++i], NULL, 0);
+		else if (strcmp(argv[i], "-w") == 0)
+			heightsPath = argv[++i];
+		else
+			Usage(argv[0]);
+	}
+	
+	if (numFrames == 0 || onlyLevel > numLevels || (columns != resolutionSteps[0] && columns != resolutionSteps[1] && columns != resolutionSteps[2]))
+		Usage(argv[0]);
+	
+	if (scriptPath)
+	{
+		if (!HostLoadScript(scriptPath))
+		{
+			fprintf(stderr, "%s: cannot load script %s\n", argv[0], scriptPath);
+			return 1;
+		}
+	}
+	else
+		HostParseScript(defaultScript);
+	
+	SeedRandom(1);
+	
+	Init();
+	SetResolution(columns);
+	
+	if (timedemo)
+	{
+		ProfileStartClock();
+		Timedemo();
+		return 0;
+	}
+	
+	if (kernels)
+	{
+		BenchKernelVariants(numFrames, onlyLevel);
+		return 0;
+	}
+	
+	if (heightsPath)
+	{
+		if (!WriteWallHeights(heightsPath, numFrames, onlyLevel))
+		{
+			perror(heightsPath);
+			return 1;
+		}
+		
+		return 0;
+	}
+	
+#if PROFILER
+	ProfileInit();
+#endif
+	
+	uint64_t *times = malloc(numFrames * sizeof(uint64_t));
+	
+	printf("level,frames,mean_ns,p50_ns,p99_ns,hash\n");
+	
+	for (uint32_t benchLevel = 1; benchLevel <= numLevels; benchLevel++)
+	{
+		if (onlyLevel && benchLevel != onlyLevel)
+			continue;
+		
+		level = benchLevel;
+		LoadLevel();
+		state = 1;
+		health = 100;
+		HostRewindScript();
+		
+		uint32_t hash = 2166136261u;
+		uint64_t total = 0;
+		
+		for (uint32_t i = 0; i < numFrames; i++)
+		{
+			ReadInput();
+			
+			uint64_t t0 = Now();
+#if PROFILER
+			ProfileBegin();
+#endif
+			Update();
+			PROFILE_MARK(PROFILE_UPDATE);
+			Render();
+			uint64_t t1 = Now();
+#if PROFILER
+			ProfileEndFrame();
+#endif
+			
+			times[i] = t1 - t0;
+			total += times[i];
+			FlipPage();
+			hash = HashPage(hash, shownPage);
+		}
+		
+		if (ppmPrefix)
+			WritePage(ppmPrefix, benchLevel, shownPage);
+		
+		qsort(times, numFrames, sizeof(uint64_t), CompareTimes);
+		
+		printf("%u,%u,%llu,%llu,%llu,%08x\n", benchLevel, numFrames,
+			(unsigned long long) (total / numFrames),
+			(unsigned long long) times[numFrames / 2],
+			(unsigned long long) times[(numFrames * 99) / 100],
+			hash);
+	}
+	
+	free(times);
+	
+	return 0;
+}
@@ -0,0 +1,490 @@
+// Eternal Horror
+// Copyright(C) 2020 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// Host checks for the fixed point code, the compiled scalers, the blit layer,
+// dynamic resolution, interlacing and lighting. Prints one line per check and
+// exits non-zero if any of them fail.
+
+#include <gba_video.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "blit.h"
+#include "demo.h"
+#include "graphics.h"
+#include "host.h"
+#include "kernels.h"
+#include "light.h"
+#include "scalers.h"
+
+static uint32_t failures = 0;
+
+static void Report(const char *name, uint32_t failed)
+{
+	printf("%-40s %s\n", name, failed ? "FAILED" : "ok");
+	failures += failed != 0;
+}
+
+// The binary search over scalarTable that projectHeight replaced
+static uint32_t FindHeight(fixed_t d)
+{
+	int32_t l = 0;
+	int32_t r = MAX_HEIGHT / 2 - 1;
+	
+	while (l <= r)
+	{
+		int32_t m = l + ((r - l) >> 1);
+		
+		if ((scalarTable[m] << (6 + PROJECTION_SHIFT)) == d)
+			return MAX_HEIGHT - 2 * m;
+		
+		if ((scalarTable[m] << (6 + PROJECTION_SHIFT)) < d)
+			l = m + 1;
+		else
+			r = m - 1;
+	}
+	
+	if (r < 0)
+		return MAX_HEIGHT;
+	
+	return MAX_HEIGHT - 2 * r;
+}
+
+static void CheckProjectHeight()
+{
+	uint32_t failed = 0;
+	
+	// Both only depend on d >> 6, so the first and last distance of every
+	// 64 unit step covers the whole non-negative range
+	for (int64_t d = 0; d <= INT_MAX; d += 64)
+	{
+		if (projectHeight(d) != FindHeight(d) || projectHeight(d + 63) != FindHeight(d + 63))
+		{
+			if (failed++ < 8)
+				printf("  projectHeight(%lld) = %u, FindHeight = %u\n", (long long) d, projectHeight(d), FindHeight(d));
+		}
+	}
+	
+	for (int64_t d = -1; d >= INT_MIN; d -= 65537)
+	{
+		if (projectHeight(d) != FindHeight(d))
+			failed++;
+	}
+	
+	Report("projectHeight matches FindHeight", failed);
+}
+
+static uint32_t WithinError(int64_t value, int64_t exact, int64_t saturated)
+{
+	if (exact > INT_MAX || exact < INT_MIN)
+		return value == saturated;
+	
+	int64_t error = llabs(value - exact);
+	return error <= 1 || error <= llabs(exact) >> 16;
+}
+
+static void CheckRecip()
+{
+	uint32_t failed = 0;
+	
+	for (int64_t a = 1; a <= INT_MAX; a += 1 + (a >> 12))
+	{
+		int64_t exact = ((int64_t) 1 << 32) / a;
+		
+		if (!WithinError(fixedRecip(a), exact, INT_MAX) || !WithinError(fixedRecip(-a), -exact, INT_MIN))
+		{
+			if (failed++ < 8)
+				printf("  fixedRecip(%lld) = %d, expected %lld\n", (long long) a, fixedRecip(a), (long long) exact);
+		}
+	}
+	
+	Report("fixedRecip within 2^-16 of 2^32 / a", failed);
+}
+
+static void CheckDiv()
+{
+	uint32_t failed = 0;
+	
+	for (int64_t b = 1; b <= INT_MAX; b += 1 + (b >> 6))
+	{
+		for (int64_t a = 0; a <= INT_MAX; a += 1 + (a >> 4))
+		{
+			int64_t exact = (a << 16) / b;
+			
+			if (!WithinError(fixedDiv(a, b), exact, INT_MAX) || !WithinError(fixedDiv(-a, b), -exact, INT_MIN) || !WithinError(fixedDiv(a, -b), -exact, INT_MIN))
+			{
+				if (failed++ < 8)
+					printf("  fixedDiv(%lld, %lld) = %d, expected %lld\n", (long long) a, (long long) b, fixedDiv(a, b), (long long) exact);
+			}
+		}
+	}
+	
+	Report("fixedDiv within 2^-16 of (a << 16) / b", failed);
+}
+
+static uint32_t MulAgrees(fixed_t a, fixed_t b)
+{
+	return fixedMulFast(a, b) == fixedMulSat(a, b) && fixedMulSat(a, b) == fixedMul(a, b);
+}
+
+// Every operand pair in [-range, range] x table, sampled with stride plus the
+// extremes, where the product is largest
+static uint32_t MulAgreesOver(fixed_t range, fixed_t (*table)(angle_t))
+{
+	uint32_t failed = 0;
+	
+	for (angle_t angle = 0; angle < ANGLES; angle++)
+	{
+		fixed_t b = table(angle);
+		
+		for (int64_t a = -range; a <= range; a += 4099)
+			failed += !MulAgrees(a, b);
+		
+		failed += !MulAgrees(range, b) + !MulAgrees(-range, b);
+	}
+	
+	return failed;
+}
+
+// The operand ranges of the fixedMulFast call sites in Render()
+static void CheckMulRanges()
+{
+	// Ray setup: the first gridline is at most one cell (64 << FRACBITS)
+	// from the camera, scaled by cot or tan of the ray angle
+	Report("fixedMulFast: ray setup", MulAgreesOver(64 << FRACBITS, fixedCot) + MulAgreesOver(64 << FRACBITS, fixedTan));
+	
+	// Hit and sprite distances: a point inside the 64x64 cell map, plus half
+	// of the largest gridline step to a door, relative to the camera, scaled
+	// by sin or cos
+	fixed_t mapRange = (64 << 22) + fixedMul(32 << FRACBITS, -fixedCot(ANGLES - 1));
+	Report("fixedMulFast: hit and sprite distances", MulAgreesOver(mapRange, fixedSin) + MulAgreesOver(mapRange, fixedCos));
+	
+	// Plane rows: every row distance, its x and y offsets at both view edges
+	// and the step across the view
+	uint32_t failed = 0;
+	
+	for (uint32_t i = 0; i < VIEW_HEIGHT / 2; i++)
+	{
+		failed += !MulAgrees(planeDistanceTable[i], fovInvCos);
+		fixed_t distance = fixedMulFast(planeDistanceTable[i], fovInvCos);
+		
+		for (angle_t angle = 0; angle < ANGLES; angle++)
+		{
+			failed += !MulAgrees(distance, fixedSin(angle)) + !MulAgrees(distance, fixedCos(angle));
+			failed += !MulAgrees(2 * fixedMulFast(distance, fixedCos(angle)), invViewWidth);
+		}
+	}
+	
+	Report("fixedMulFast: plane rows", failed);
+}
+
+// Every compiled scaler against the loop DrawWallSlice falls back to
+static void CheckScalers()
+{
+	static uint16_t expected[VIEW_HEIGHT * VIEW_STRIDE];
+	static uint16_t actual[VIEW_HEIGHT * VIEW_STRIDE];
+	static uint8_t texture[64];
+	uint32_t failed = 0;
+	
+	for (uint32_t i = 0; i < 64; i++)
+		texture[i] = rand();
+	
+#if COMPACT_FRAMEBUFFER
+	for (uint32_t i = 0; i < 256; i++)
+		colorTable[i] = rand();
+#endif
+#if LIGHTING
+	for (uint32_t i = 0; i < 256; i++)
+		lightTables[0][i] = rand();
+	
+	lightTable = lightTables[0];
+#endif
+	
+	for (uint32_t wallHeight = 2; wallHeight <= MAX_HEIGHT; wallHeight += 2)
+	{
+		if (!scalerTable[wallHeight >> 1])
+			continue;
+		
+		fixed_t scalar = scalarTable[(MAX_HEIGHT - wallHeight) >> 1];
+		int32_t wallY = (VIEW_HEIGHT - (int32_t)wallHeight) >> 1;
+		
+		memset(expected, 0, sizeof(expected));
+		memset(actual, 0, sizeof(actual));
+		
+		if (wallY < 0)
+			DrawWallColumnC(expected, texture, -wallY * scalar, scalar, VIEW_HEIGHT - 1);
+		else
+			DrawWallColumnC(expected, texture, 0, scalar, wallHeight - 1);
+		
+		scalerTable[wallHeight >> 1](actual, texture);
+		failed += memcmp(expected, actual, sizeof(expected)) != 0;
+	}
+	
+	Report("compiled scalers match DrawWallColumn", failed);
+}
+
+// Fills and copies at every alignment and length around the thresholds of
+// blit.h against halfword loops, with a guard halfword either side
+static void CheckBlit()
+{
+	static uint16_t expected[4096];
+	static uint16_t actual[4096];
+	static uint16_t source[4096];
+	uint32_t failed = 0;
+	
+	for (uint32_t i = 0; i < 4096; i++)
+		source[i] = rand();
+	
+	for (uint32_t offset = 1; offset <= 2; offset++)
+	{
+		for (uint32_t count = 0; count <= 2 * BLIT_FAST_MIN + 20; count++)
+		{
+			memset(expected, 0, sizeof(expected));
+			memset(actual, 0, sizeof(actual));
+			
+			for (uint32_t i = 0; i < count; i++)
+				expected[offset + i] = 0x2A2A;
+			
+			BlitFill(&actual[offset], 0x2A2A, count);
+			failed += memcmp(expected, actual, sizeof(expected)) != 0;
+			
+			for (uint32_t srcOffset = 0; srcOffset <= 1; srcOffset++)
+			{
+				memset(expected, 0, sizeof(expected));
+				memset(actual, 0, sizeof(actual));
+				memcpy(&expected[offset], &source[srcOffset], count * sizeof(uint16_t));
+				BlitCopy(&actual[offset], &source[srcOffset], count);
+				failed += memcmp(expected, actual, sizeof(expected)) != 0;
+			}
+		}
+	}
+	
+	static const uint32_t widths[] = { 1, 15, 16, 28, 64, 120 };
+	
+	for (uint32_t i = 0; i < sizeof(widths) / sizeof(widths[0]); i++)
+	{
+		for (uint32_t x = 0; x <= 1; x++)
+		{
+			memset(expected, 0, sizeof(expected));
+			memset(actual, 0, sizeof(actual));
+			
+			for (uint32_t y = 0; y < 20; y++)
+			{
+				for (uint32_t j = 0; j < widths[i]; j++)
+					expected[1 + y * 120 + x + j] = 0x2A2A;
+			}
+			
+			BlitFillRows(&actual[1 + x], 0x2A2A, widths[i], 20, 120);
+			failed += memcmp(expected, actual, sizeof(expected)) != 0;
+		}
+	}
+	
+	Report("blit fills and copies match loops", failed);
+}
+
+// Frame costs around the thresholds of ResolutionUpdate: costly frames drop a
+// step each down to half the columns, cheap ones only go back up after a run
+// of 30 that a middling frame starts over
+static void CheckResolution()
+{
+	uint32_t failed = 0;
+	uint32_t drops = resolutionDrops;
+	
+	SetResolution(resolutionSteps[0]);
+	
+	for (uint32_t i = 0; i < 3; i++)
+		ResolutionUpdate(270000);
+	
+	failed += renderColumns != resolutionSteps[2] || resolutionDrops != drops + 2;
+	
+	for (uint32_t i = 0; i < 29; i++)
+		ResolutionUpdate(150000);
+	
+	ResolutionUpdate(200000);
+	failed += renderColumns != resolutionSteps[2];
+	
+	for (uint32_t i = 0; i < 29; i++)
+		ResolutionUpdate(150000);
+	
+	failed += renderColumns != resolutionSteps[2];
+	ResolutionUpdate(150000);
+	failed += renderColumns != resolutionSteps[1];
+	
+	for (uint32_t i = 0; i < 30; i++)
+		ResolutionUpdate(150000);
+	
+	failed += renderColumns != resolutionSteps[0];
+	
+	Report("ResolutionUpdate drops and restores", failed);
+}
+
+// A still camera's interlaced frame copies the columns it does not trace
+// from the last frame, which drew the same view, so it matches a full frame
+static void CheckInterlace()
+{
+	static uint16_t interlaced[ROW_STRIDE * PAGE_ROWS];
+	const uint16_t *vram = (const uint16_t *) (VRAM | 0xA000);
+	uint32_t failed = 0;
+	
+	Init();
+	level = 1;
+	LoadLevel();
+	state = 1;
+	health = 100;
+	interlaceColumns = 1;
+	
+	page = 0;
+	Render();
+	
+	uint32_t copies = interlaceCopies;
+	page = 1;
+	Render();
+	copies = interlaceCopies - copies;
+	memcpy(interlaced, vram, sizeof(interlaced));
+	
+	interlaceColumns = 0;
+	Render();
+	
+	failed += copies == 0 || copies > VIEW_WIDTH / 2;
+	failed += memcmp(interlaced, vram, sizeof(interlaced)) != 0;
+	
+	Report("interlaced frame matches a full one", failed);
+}
+
+#define INTERLACE_FRAMES 300
+
+// Plays level from the start with the key script, interlaced or not, and
+// keeps a hash of every frame's view. Returns how many columns it copied.
+static uint32_t PlayInterlaced(uint32_t playLevel, uint32_t interlace, uint32_t *hashes)
+{
+	uint32_t copies = interlaceCopies;
+	
+	SeedRandom(1);
+	Init();
+	frame = 0;
+	frameTics = 0;
+	level = playLevel;
+	LoadLevel();
+	state = 1;
+	health = 100;
+	interlaceColumns = interlace;
+	HostRewindScript();
+	
+	for (uint32_t i = 0; i < INTERLACE_FRAMES; i++)
+	{
+		ReadInput();
+		Update();
+		Render();
+		
+		uint32_t hash = 2166136261u;
+		
+		for (uint32_t y = 0; y < VIEW_HEIGHT; y++)
+		{
+			for (uint32_t x = 0; x < VIEW_WIDTH; x++)
+				hash = (hash ^ yTable[page][y][xTable[x]]) * 16777619u;
+		}
+		
+		hashes[i] = hash;
+		FlipPage();
+	}
+	
+	return interlaceCopies - copies;
+}
+
+// A camera that turns, walks and strafes, stops and fires, with enemies
+// moving and animating in view, draws every frame interlaced the same as in
+// full, though the copies are made on the frames it stands still
+static void CheckInterlacePlay()
+{
+	static uint32_t full[INTERLACE_FRAMES];
+	static uint32_t interlaced[INTERLACE_FRAMES];
+	uint32_t failed = 0;
+	
+	HostParseScript(
+		"20 LEFT\n"
+		"20 UP\n"
+		"20 -\n"
+		"15 R\n"
+		"20 -\n"
+		"10 A\n"
+		"20 RIGHT\n"
+		"20 UP+L\n"
+		"20 -\n");
+	
+	for (uint32_t playLevel = 1; playLevel <= numLevels; playLevel++)
+	{
+		PlayInterlaced(playLevel, 0, full);
+		failed += PlayInterlaced(playLevel, 1, interlaced) == 0;
+		failed += memcmp(full, interlaced, sizeof(full)) != 0;
+	}
+	
+	interlaceColumns = 0;
+	
+	Report("interlaced play matches full frames", failed);
+}
+
+#if LIGHTING
+// Level 0 is the palette, level LIGHT_LEVELS the fog colour, and LightTable
+// moves a level every LIGHT_BAND into the fog
+static void CheckLight()
+{
+	uint32_t failed = 0;
+	
+	Init();
+	
+	for (uint32_t i = 0; i < 256; i++)
+	{
+#if COMPACT_FRAMEBUFFER
+		failed += lightTables[0][i] != (graphicsPal[i] & 0x7FFF);
+		failed += lightTables[LIGHT_LEVELS][i] != (graphicsPal[FOG_COLOR] & 0x7FFF);
+#else
+		failed += lightTables[0][i] != i;
+		failed += graphicsPal[lightTables[LIGHT_LEVELS][i]] != graphicsPal[FOG_COLOR];
+#endif
+	}
+	
+	for (uint32_t level = 0; level < LIGHT_LEVELS; level++)
+	{
+		failed += LightTable(level * LIGHT_BAND) != lightTables[level];
+		failed += LightTable((level + 1) * LIGHT_BAND - 1) != lightTables[level];
+	}
+	
+	failed += LightTable(FOG_DEPTH) != lightTables[LIGHT_LEVELS];
+	failed += LightTable(INT_MAX) != lightTables[LIGHT_LEVELS];
+	
+	Report("light tables fade into the fog", failed);
+}
+#endif
+
+int main()
+{
+	InitViewTables();
+	
+	CheckProjectHeight();
+	CheckRecip();
+	CheckDiv();
+	CheckMulRanges();
+	CheckScalers();
+	CheckBlit();
+	CheckResolution();
+	CheckInterlace();
+	CheckInterlacePlay();
+#if LIGHTING
+	CheckLight();
+#endif
+	
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,96 @@
+// Eternal Horror
+// Copyright(C) 2020 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#include <gba_dma.h>
+#include <gba_sprites.h>
+#include <gba_video.h>
+#include <gba_interrupt.h>
+#include <gba_systemcalls.h>
+#include <string.h>
+
+uint16_t hostVram[0xC000] __attribute__((aligned(0x20000)));
+uint16_t hostPalette[512];
+OBJATTR hostOam[128];
+uint16_t hostDispCnt;
+int16_t hostBg2P[4] = { 1 << 8, 0, 0, 1 << 8 };
+int32_t hostBg2X;
+int32_t hostBg2Y;
+uint16_t hostWin0[2];
+uint16_t hostWinCnt[2];
+uint16_t hostIme;
+
+void irqInit()
+{
+}
+
+IntFn *irqSet(int mask, IntFn function)
+{
+	return 0;
+}
+
+void irqEnable(int mask)
+{
+}
+
+void VBlankIntrWait()
+{
+}
+
+// A word count rounded up to whole blocks of 8, as the BIOS does
+void CpuFastSet(const void *source, void *dest, uint32_t mode)
+{
+	const uint32_t *s = source;
+	uint32_t *d = dest;
+	uint32_t count = ((mode & 0x1FFFFF) + 7) & ~7;
+	
+	if (mode & FILL)
+	{
+		uint32_t word = *s;
+		
+		for (uint32_t i = 0; i < count; i++)
+			d[i] = word;
+	}
+	else
+		memmove(d, s, count * sizeof(uint32_t));
+}
+
+void hostDma3(const volatile void *source, volatile void *dest, uint32_t control)
+{
+	uint32_t size = (control & DMA32) ? 4 : 2;
+	uint32_t count = control & 0xFFFF;
+	int32_t srcStep = ((control >> 23) & 3) == 1 ? -size : ((control >> 23) & 3) == 2 ? 0 : size;
+	int32_t dstStep = ((control >> 21) & 3) == 1 ? -size : ((control >> 21) & 3) == 2 ? 0 : size;
+	const uint8_t *s = (const uint8_t *) source;
+	uint8_t *d = (uint8_t *) dest;
+	
+	// a count of 0 is the largest, 0x10000 units on DMA3
+	if (count == 0)
+		count = 0x10000;
+	
+	if (srcStep == (int32_t) size && dstStep == (int32_t) size)
+	{
+		memmove(d, s, count * size);
+		return;
+	}
+	
+	while (count--)
+	{
+		if (size == 4)
+			*(uint32_t *) d = *(const uint32_t *) s;
+		else
+			*(uint16_t *) d = *(const uint16_t *) s;
+		
+		s += srcStep;
+		d += dstStep;
+	}
+}
@@ -0,0 +1,69 @@
+// Eternal Horror
+// Copyright(C) 2020 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#ifndef __HOST_H__
+#define __HOST_H__
+
+#include <stdint.h>
+
+#include "fixed.h"
+#include "kernels.h"
+
+// Engine state and entry points from source/main.c
+
+extern uint32_t level;
+extern const uint32_t numLevels;
+extern uint32_t state;
+extern int32_t health;
+extern uint32_t page;
+extern volatile uint32_t shownPage;
+extern fixed_t cameraX;
+extern fixed_t cameraY;
+extern angle_t cameraAngle;
+extern uint16_t *yTable[PAGES][VIEW_HEIGHT];
+extern uint16_t xTable[VIEW_WIDTH];
+extern fixed_t planeDistanceTable[VIEW_HEIGHT / 2];
+extern fixed_t fovInvCos;
+extern fixed_t invViewWidth;
+extern fixed_t zBuffer[VIEW_WIDTH];
+extern uint32_t solidPlanes;
+extern const uint32_t resolutionSteps[3];
+extern uint32_t renderColumns;
+extern uint32_t resolutionDrops;
+extern uint32_t interlaceColumns;
+extern uint32_t interlaceCopies;
+
+// The enemies' animation clock, which LoadLevel() leaves running
+extern uint32_t frame;
+extern uint32_t frameTics;
+
+void Init();
+void InitViewTables();
+void LoadLevel();
+void Update();
+void Render();
+void FlipPage();
+void SetResolution(uint32_t columns);
+void ResolutionUpdate(uint32_t cycles);
+
+// Key script
+//
+// A script is a list of "<frames> <keys>" lines, keys joined with '+' from
+// A B SELECT START RIGHT LEFT UP DOWN R L, or '-' for no keys. Blank lines and
+// text after '#' are ignored. The script loops when it runs out.
+
+int HostLoadScript(const char *path);
+void HostParseScript(const char *text);
+void HostRewindScript();
+
+#endif
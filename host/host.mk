@@ -0,0 +1,90 @@
+#---------------------------------------------------------------------------------
+# Host build of the engine
+#
+# Builds source/*.c for the build machine against the libgba stand-ins in
+# host/include and links them with the framebuffer, input and benchmark code in
+# host/. Level and graphics data are converted by host/mkdata.c.
+#
+#   make bench          build ./bench
+#   make check          build and run the host checks
+#   make replay         build ./replay, which records and replays input, see
+#                       demo.h
+#   make bench DEFINES="-DDDA_RAYCASTER=0"
+#                       build it with compile time options changed, run
+#                       make hostclean first when switching options
+#   make hostclean      remove the host build
+#---------------------------------------------------------------------------------
+HOSTBUILD	:=	build-host
+DEFINES		:=
+
+HOSTCFLAGS	:=	-g -Wall -O2 -DHOST\
+		-Ihost/include -iquote include -iquote host -iquote $(HOSTBUILD)\
+		$(DEFINES)
+
+HOSTLEVELS	:=	$(patsubst levels/%.map.bin,%_map_bin,$(wildcard levels/*.map.bin))
+HOSTDATA	:=	$(HOSTLEVELS:%=$(HOSTBUILD)/%.c) $(HOSTBUILD)/graphics.c
+HOSTENGINE	:=	$(patsubst source/%.c,$(HOSTBUILD)/%.o,$(wildcard source/*.c))
+HOSTSHIM	:=	$(HOSTBUILD)/gba.o $(HOSTBUILD)/input.o
+HOSTOBJS	:=	$(HOSTENGINE) $(HOSTSHIM) $(HOSTDATA:.c=.o) $(HOSTBUILD)/scalers.o $(HOSTBUILD)/sprites.o
+
+.PHONY: bench check replay hostclean
+
+bench: $(HOSTBUILD)/bench.o $(HOSTOBJS)
+	$(HOSTCC) -o $@ $^
+
+replay: $(HOSTBUILD)/replay.o $(HOSTOBJS)
+	$(HOSTCC) -o $@ $^
+
+check: $(HOSTBUILD)/check
+	$(HOSTBUILD)/check
+
+$(HOSTBUILD)/check: $(HOSTBUILD)/check.o $(HOSTOBJS)
+	$(HOSTCC) -o $@ $^
+
+hostclean:
+	@echo clean host ...
+	@rm -fr $(HOSTBUILD) bench replay
+
+$(HOSTBUILD)/mkdata: host/mkdata.c | $(HOSTBUILD)
+	$(HOSTCC) -O2 -Wall -o $@ $<
+
+$(HOSTBUILD)/%_map_bin.c $(HOSTBUILD)/%_map_bin.h: levels/%.map.bin $(HOSTBUILD)/mkdata
+	$(HOSTBUILD)/mkdata bin $< $*_map_bin $(HOSTBUILD)
+
+$(HOSTBUILD)/graphics.c $(HOSTBUILD)/graphics.h: graphics/graphics.bmp $(HOSTBUILD)/mkdata
+	$(HOSTBUILD)/mkdata bmp $< graphics $(HOSTBUILD)
+
+$(HOSTBUILD)/mkscalers: tools/mkscalers.c include/view.h | $(HOSTBUILD)
+	$(HOSTCC) -O2 -Wall $(DEFINES) -iquote include -o $@ $<
+
+$(HOSTBUILD)/scalers.c: $(HOSTBUILD)/mkscalers tools/wallheights.txt
+	$(HOSTBUILD)/mkscalers c $(SCALER_BUDGET) $@ tools/wallheights.txt
+
+$(HOSTBUILD)/scalers.o: $(HOSTBUILD)/scalers.c
+	$(HOSTCC) $(HOSTCFLAGS) -c -o $@ $<
+
+$(HOSTBUILD)/mksprites: tools/mksprites.c include/sprites.h | $(HOSTBUILD)
+	$(HOSTCC) -O2 -Wall -iquote include -o $@ $<
+
+# graphics.img.bin is written by the same mkdata run as graphics.c
+$(HOSTBUILD)/sprites.c: $(HOSTBUILD)/mksprites $(HOSTBUILD)/graphics.c
+	$(HOSTBUILD)/mksprites $(HOSTBUILD)/graphics.img.bin $@
+
+$(HOSTBUILD)/sprites.o: $(HOSTBUILD)/sprites.c
+	$(HOSTCC) $(HOSTCFLAGS) -c -o $@ $<
+
+$(HOSTENGINE) $(HOSTBUILD)/bench.o $(HOSTBUILD)/check.o $(HOSTBUILD)/replay.o: $(HOSTDATA)
+
+$(HOSTBUILD)/%.o: source/%.c | $(HOSTBUILD)
+	$(HOSTCC) $(HOSTCFLAGS) -MMD -c -o $@ $<
+
+$(HOSTBUILD)/%.o: host/%.c | $(HOSTBUILD)
+	$(HOSTCC) $(HOSTCFLAGS) -MMD -c -o $@ $<
+
+$(HOSTBUILD)/%.o: $(HOSTBUILD)/%.c
+	$(HOSTCC) -c -o $@ $<
+
+$(HOSTBUILD):
+	@mkdir -p $@
+
+-include $(HOSTBUILD)/*.d
@@ -0,0 +1,39 @@
+// Eternal Horror
+// Copyright(C) 2020 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// Host stand-in for libgba's gba_base.h. Section attributes are dropped and
+// memory mapped registers become plain variables owned by host/gba.c.
+
+#ifndef __GBA_BASE_H__
+#define __GBA_BASE_H__
+
+#include <stdint.h>
+
+#define IWRAM_CODE
+#define EWRAM_CODE
+#define IWRAM_DATA
+#define EWRAM_DATA
+#define EWRAM_BSS
+#define ARM_CODE
+#define THUMB_CODE
+
+#define BIT(number) (1 << (number))
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+
+#endif
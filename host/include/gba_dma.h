@@ -0,0 +1,37 @@
+// Eternal Horror
+// Copyright(C) 2020 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// Host stand-in for libgba's gba_dma.h. DMA3COPY runs the transfer at once
+// in host/gba.c instead of writing the DMA3 registers.
+
+#ifndef __GBA_DMA_H__
+#define __GBA_DMA_H__
+
+#include "gba_base.h"
+
+#define DMA_DST_INC (0 << 21)
+#define DMA_DST_DEC (1 << 21)
+#define DMA_DST_FIXED (2 << 21)
+#define DMA_SRC_INC (0 << 23)
+#define DMA_SRC_DEC (1 << 23)
+#define DMA_SRC_FIXED (2 << 23)
+#define DMA16 (0 << 26)
+#define DMA32 (1 << 26)
+#define DMA_IMMEDIATE (0 << 28)
+#define DMA_ENABLE (1u << 31)
+
+void hostDma3(const volatile void *source, volatile void *dest, uint32_t control);
+
+#define DMA3COPY(source, dest, mode) hostDma3(source, dest, DMA_ENABLE | (mode))
+
+#endif
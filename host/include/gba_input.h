@@ -0,0 +1,40 @@
+// Eternal Horror
+// Copyright(C) 2020 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// Host stand-in for libgba's gba_input.h. scanKeys() advances the key script
+// loaded by host/input.c instead of reading REG_KEYINPUT.
+
+#ifndef __GBA_INPUT_H__
+#define __GBA_INPUT_H__
+
+#include "gba_base.h"
+
+typedef enum KEYPAD_BITS
+{
+	KEY_A = BIT(0),
+	KEY_B = BIT(1),
+	KEY_SELECT = BIT(2),
+	KEY_START = BIT(3),
+	KEY_RIGHT = BIT(4),
+	KEY_LEFT = BIT(5),
+	KEY_UP = BIT(6),
+	KEY_DOWN = BIT(7),
+	KEY_R = BIT(8),
+	KEY_L = BIT(9)
+} KEYPAD_BITS;
+
+void scanKeys();
+uint16_t keysHeld();
+uint16_t keysDown();
+
+#endif
@@ -0,0 +1,43 @@
+// Eternal Horror
+// Copyright(C) 2020 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// Host stand-in for libgba's gba_interrupt.h. There are no interrupts on the
+// host; handlers are registered and never called.
+
+#ifndef __GBA_INTERRUPT_H__
+#define __GBA_INTERRUPT_H__
+
+#include "gba_base.h"
+
+typedef void (*IntFn)(void);
+
+enum irqMASKS
+{
+	IRQ_VBLANK = BIT(0),
+	IRQ_HBLANK = BIT(1),
+	IRQ_VCOUNT = BIT(2),
+	IRQ_TIMER0 = BIT(3),
+	IRQ_TIMER1 = BIT(4),
+	IRQ_TIMER2 = BIT(5),
+	IRQ_TIMER3 = BIT(6)
+};
+
+extern uint16_t hostIme;
+
+#define REG_IME (hostIme)
+
+void irqInit();
+IntFn *irqSet(int mask, IntFn function);
+void irqEnable(int mask);
+
+#endif
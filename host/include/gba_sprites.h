@@ -0,0 +1,54 @@
+// Eternal Horror
+// Copyright(C) 2020 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// Host stand-in for libgba's gba_sprites.h. OAM is a plain array owned by
+// host/gba.c and OBJ VRAM the upper part of hostVram.
+
+#ifndef __GBA_SPRITES_H__
+#define __GBA_SPRITES_H__
+
+#include "gba_video.h"
+
+typedef struct
+{
+	uint16_t attr0;
+	uint16_t attr1;
+	uint16_t attr2;
+	uint16_t dummy;
+} OBJATTR;
+
+extern OBJATTR hostOam[128];
+
+#define OAM (hostOam)
+#define OBJ_BASE_ADR ((void *) (VRAM + 0x10000))
+#define BITMAP_OBJ_BASE_ADR ((void *) (VRAM + 0x14000))
+
+#define OBJ_Y(m) ((m) & 0x00FF)
+#define ATTR0_NORMAL (0 << 8)
+#define ATTR0_DISABLED (2 << 8)
+#define ATTR0_COLOR_16 (0 << 13)
+#define ATTR0_COLOR_256 (1 << 13)
+#define ATTR0_SQUARE (0 << 14)
+#define ATTR0_WIDE (1 << 14)
+#define ATTR0_TALL (2 << 14)
+
+#define OBJ_X(m) ((m) & 0x01FF)
+#define ATTR1_SIZE_8 (0 << 14)
+#define ATTR1_SIZE_16 (1 << 14)
+#define ATTR1_SIZE_32 (2 << 14)
+#define ATTR1_SIZE_64 (3 << 14)
+
+#define OBJ_CHAR(m) ((m) & 0x03FF)
+#define OBJ_PRIORITY(m) (((m) & 3) << 10)
+
+#endif
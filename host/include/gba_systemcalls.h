@@ -0,0 +1,28 @@
+// Eternal Horror
+// Copyright(C) 2020 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// Host stand-in for libgba's gba_systemcalls.h.
+
+#ifndef __GBA_SYSTEMCALLS_H__
+#define __GBA_SYSTEMCALLS_H__
+
+#include "gba_base.h"
+
+#define COPY16 0
+#define COPY32 BIT(26)
+#define FILL BIT(24)
+
+void VBlankIntrWait();
+void CpuFastSet(const void *source, void *dest, uint32_t mode);
+
+#endif
@@ -0,0 +1,62 @@
+// Eternal Horror
+// Copyright(C) 2020 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// Host stand-in for libgba's gba_video.h. VRAM is a 96 KiB array aligned so
+// that "VRAM | 0xA000" still addresses the mode 4 back page.
+
+#ifndef __GBA_VIDEO_H__
+#define __GBA_VIDEO_H__
+
+#include "gba_base.h"
+
+#define SCREEN_WIDTH 240
+#define SCREEN_HEIGHT 160
+
+#define MODE_4 4
+#define MODE_5 5
+#define BACKBUFFER BIT(4)
+#define OBJ_1D_MAP BIT(6)
+#define BG2_ON BIT(10)
+#define OBJ_ON BIT(12)
+#define WIN0_ON BIT(13)
+
+#define RGB5(r, g, b) ((r) | ((g) << 5) | ((b) << 10))
+#define RGB8(r, g, b) ((((b) >> 3) << 10) | (((g) >> 3) << 5) | ((r) >> 3))
+
+extern uint16_t hostVram[0xC000];
+extern uint16_t hostPalette[512];
+extern uint16_t hostDispCnt;
+extern int16_t hostBg2P[4];
+extern int32_t hostBg2X;
+extern int32_t hostBg2Y;
+extern uint16_t hostWin0[2];
+extern uint16_t hostWinCnt[2];
+
+#define VRAM ((uintptr_t) hostVram)
+#define BG_COLORS (hostPalette)
+#define OBJ_COLORS (&hostPalette[256])
+#define REG_DISPCNT (hostDispCnt)
+#define REG_BG2PA (hostBg2P[0])
+#define REG_BG2PB (hostBg2P[1])
+#define REG_BG2PC (hostBg2P[2])
+#define REG_BG2PD (hostBg2P[3])
+#define REG_BG2X (hostBg2X)
+#define REG_BG2Y (hostBg2Y)
+#define REG_WIN0H (hostWin0[0])
+#define REG_WIN0V (hostWin0[1])
+#define REG_WININ (hostWinCnt[0])
+#define REG_WINOUT (hostWinCnt[1])
+
+#define SetMode(mode) (REG_DISPCNT = (mode))
+
+#endif
@@ -0,0 +1,149 @@
+// Eternal Horror
+// Copyright(C) 2020 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#include <gba_input.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host.h"
+
+typedef struct
+{
+	uint32_t frames;
+	uint16_t keys;
+} step_t;
+
+static const struct
+{
+	const char *name;
+	uint16_t key;
+} keyNames[] =
+{
+	{ "A", KEY_A }, { "B", KEY_B }, { "SELECT", KEY_SELECT }, { "START", KEY_START },
+	{ "RIGHT", KEY_RIGHT }, { "LEFT", KEY_LEFT }, { "UP", KEY_UP }, { "DOWN", KEY_DOWN },
+	{ "R", KEY_R }, { "L", KEY_L }
+};
+
+static step_t steps[1024];
+static uint32_t numSteps = 0;
+static uint32_t currentStep = 0;
+static uint32_t stepFrames = 0;
+
+static uint16_t held = 0;
+static uint16_t down = 0;
+
+static uint16_t ParseKeys(char *text)
+{
+	uint16_t keys = 0;
+	
+	for (char *name = strtok(text, "+"); name; name = strtok(NULL, "+"))
+	{
+		for (uint32_t i = 0; i < sizeof(keyNames) / sizeof(keyNames[0]); i++)
+		{
+			if (strcmp(name, keyNames[i].name) == 0)
+				keys |= keyNames[i].key;
+		}
+	}
+	
+	return keys;
+}
+
+void HostParseScript(const char *text)
+{
+	numSteps = 0;
+	
+	while (*text && numSteps < sizeof(steps) / sizeof(steps[0]))
+	{
+		char line[256];
+		size_t length = strcspn(text, "\n");
+		
+		if (length >= sizeof(line))
+			length = sizeof(line) - 1;
+		
+		memcpy(line, text, length);
+		line[length] = '\0';
+		text += strcspn(text, "\n");
+		
+		if (*text)
+			text++;
+		
+		line[strcspn(line, "#")] = '\0';
+		
+		unsigned frames;
+		char keys[200];
+		
+		if (sscanf(line, "%u %199s", &frames, keys) == 2 && frames > 0)
+		{
+			steps[numSteps].frames = frames;
+			steps[numSteps].keys = ParseKeys(keys);
+			numSteps++;
+		}
+	}
+	
+	HostRewindScript();
+}
+
+int HostLoadScript(const char *path)
+{
+	FILE *file = fopen(path, "rb");
+	
+	if (!file)
+		return 0;
+	
+	char *text = calloc(1, 65536);
+	fread(text, 1, 65535, file);
+	fclose(file);
+	
+	HostParseScript(text);
+	free(text);
+	
+	return numSteps > 0;
+}
+
+void HostRewindScript()
+{
+	currentStep = 0;
+	stepFrames = 0;
+	held = 0;
+	down = 0;
+}
+
+void scanKeys()
+{
+	uint16_t keys = 0;
+	
+	if (numSteps > 0)
+	{
+		keys = steps[currentStep].keys;
+		
+		if (++stepFrames >= steps[currentStep].frames)
+		{
+			stepFrames = 0;
+			currentStep = (currentStep + 1) % numSteps;
+		}
+	}
+	
+	down = keys & ~held;
+	held = keys;
+}
+
+uint16_t keysHeld()
+{
+	return held;
+}
+
+uint16_t keysDown()
+{
+	return down;
+}
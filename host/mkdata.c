@@ -0,0 +1,287 @@
+// Eternal Horror
+// Copyright(C) 2020 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// Converts the level and graphics data for the host build, standing in for
+// bin2o and grit. Usage:
+//
+//   mkdata bin <file> <name> <dir>   writes <dir>/<name>.c and <dir>/<name>.h
+//   mkdata bmp <file> <name> <dir>   writes <name>Bitmap and <name>Pal, and
+//                                    the bitmap's raw indices to
+//                                    <dir>/<name>.img.bin as grit -ftb does
+//
+// The graphics are a 24-bit bitmap with more than 256 colours, so they are
+// reduced to the 256 most frequent colours with the indices the engine relies
+// on pinned: 0x00 black, 0x0C the colour key and 0x2A the blood red. grit's
+// quantizer picks a different palette, so host frames are close to but not
+// identical with what the GBA shows.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct
+{
+	uint32_t rgb;
+	uint32_t count;
+} colour_t;
+
+static uint8_t *ReadFile(const char *path, size_t *size)
+{
+	FILE *file = fopen(path, "rb");
+	
+	if (!file)
+	{
+		perror(path);
+		exit(1);
+	}
+	
+	fseek(file, 0, SEEK_END);
+	*size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	uint8_t *data = malloc(*size);
+	
+	if (fread(data, 1, *size, file) != *size)
+	{
+		perror(path);
+		exit(1);
+	}
+	
+	fclose(file);
+	return data;
+}
+
+static FILE *OpenOutput(const char *dir, const char *name, const char *extension)
+{
+	char path[4096];
+	snprintf(path, sizeof(path), "%s/%s.%s", dir, name, extension);
+	FILE *file = fopen(path, "w");
+	
+	if (!file)
+	{
+		perror(path);
+		exit(1);
+	}
+	
+	return file;
+}
+
+static void WriteArray(FILE *file, const uint8_t *data, size_t size)
+{
+	for (size_t i = 0; i < size; i++)
+		fprintf(file, "%s%u,", (i & 15) ? " " : "\n\t", data[i]);
+	
+	fprintf(file, "\n};\n");
+}
+
+static void ConvertBinary(const char *path, const char *name, const char *dir)
+{
+	size_t size;
+	uint8_t *data = ReadFile(path, &size);
+	
+	FILE *header = OpenOutput(dir, name, "h");
+	fprintf(header, "#include <stdint.h>\n\n");
+	fprintf(header, "extern const uint32_t %s[];\n", name);
+	fprintf(header, "extern const uint32_t %s_size;\n", name);
+	fclose(header);
+	
+	// The engine reads level data as words, so it is emitted as bytes in a
+	// word aligned array and declared as uint32_t in the header.
+	FILE *source = OpenOutput(dir, name, "c");
+	fprintf(source, "#include <stdint.h>\n\n");
+	fprintf(source, "const uint32_t %s_size = %zu;\n\n", name, size);
+	fprintf(source, "const uint8_t %s[] __attribute__((aligned(4))) =\n{", name);
+	WriteArray(source, data, size);
+	fclose(source);
+	free(data);
+}
+
+static int CompareColours(const void *a, const void *b)
+{
+	const colour_t *ca = a;
+	const colour_t *cb = b;
+	
+	if (ca->count != cb->count)
+		return ca->count < cb->count ? 1 : -1;
+	
+	return ca->rgb < cb->rgb ? -1 : ca->rgb > cb->rgb;
+}
+
+static uint32_t Distance(uint32_t a, uint32_t b)
+{
+	int32_t dr = (int32_t) (a >> 16) - (int32_t) (b >> 16);
+	int32_t dg = (int32_t) ((a >> 8) & 0xFF) - (int32_t) ((b >> 8) & 0xFF);
+	int32_t db = (int32_t) (a & 0xFF) - (int32_t) (b & 0xFF);
+	return dr * dr + dg * dg + db * db;
+}
+
+static void ConvertBitmap(const char *path, const char *name, const char *dir)
+{
+	size_t size;
+	uint8_t *data = ReadFile(path, &size);
+	
+	uint32_t offset = data[10] | data[11] << 8 | data[12] << 16 | data[13] << 24;
+	int32_t width = data[18] | data[19] << 8 | data[20] << 16 | data[21] << 24;
+	int32_t height = data[22] | data[23] << 8 | data[24] << 16 | data[25] << 24;
+	uint32_t bpp = data[28] | data[29] << 8;
+	
+	if (bpp != 24 || width <= 0 || height <= 0)
+	{
+		fprintf(stderr, "%s: only bottom-up 24-bit bitmaps are supported\n", path);
+		exit(1);
+	}
+	
+	uint32_t stride = (width * 3 + 3) & ~3;
+	uint32_t count = width * height;
+	uint32_t *pixels = malloc(count * sizeof(uint32_t));
+	
+	for (int32_t y = 0; y < height; y++)
+	{
+		const uint8_t *row = &data[offset + (height - 1 - y) * stride];
+		
+		for (int32_t x = 0; x < width; x++)
+			pixels[y * width + x] = row[x * 3 + 2] << 16 | row[x * 3 + 1] << 8 | row[x * 3];
+	}
+	
+	colour_t *colours = calloc(count, sizeof(colour_t));
+	uint32_t numColours = 0;
+	
+	for (uint32_t i = 0; i < count; i++)
+	{
+		uint32_t j;
+		
+		for (j = 0; j < numColours; j++)
+		{
+			if (colours[j].rgb == pixels[i])
+				break;
+		}
+		
+		if (j == numColours)
+			colours[numColours++].rgb = pixels[i];
+		
+		colours[j].count++;
+	}
+	
+	qsort(colours, numColours, sizeof(colour_t), CompareColours);
+	
+	const uint32_t black = 0x000000;
+	const uint32_t colorKey = 0x980088;
+	const uint32_t red = 0xFF0000;
+	
+	uint32_t palette[256];
+	uint32_t used[256] = { 0 };
+	palette[0x00] = black; used[0x00] = 1;
+	palette[0x0C] = colorKey; used[0x0C] = 1;
+	palette[0x2A] = red; used[0x2A] = 1;
+	
+	uint32_t slot = 0;
+	
+	for (uint32_t i = 0; i < numColours; i++)
+	{
+		uint32_t rgb = colours[i].rgb;
+		
+		if (rgb == black || rgb == colorKey || rgb == red)
+			continue;
+		
+		while (slot < 256 && used[slot])
+			slot++;
+		
+		if (slot == 256)
+			break;
+		
+		palette[slot] = rgb;
+		used[slot] = 1;
+	}
+	
+	while (slot < 256)
+	{
+		if (!used[slot])
+			palette[slot] = black;
+		
+		slot++;
+	}
+	
+	uint8_t *bitmap = malloc(count);
+	
+	for (uint32_t i = 0; i < count; i++)
+	{
+		uint32_t best = 0;
+		
+		if (pixels[i] == colorKey)
+			best = 0x0C;
+		else
+		{
+			for (uint32_t j = 1; j < 256; j++)
+			{
+				if (j != 0x0C && Distance(palette[j], pixels[i]) < Distance(palette[best], pixels[i]))
+					best = j;
+			}
+		}
+		
+		bitmap[i] = best;
+	}
+	
+	FILE *header = OpenOutput(dir, name, "h");
+	fprintf(header, "#include <stdint.h>\n\n");
+	fprintf(header, "#define %sBitmapLen %u\n", name, count);
+	fprintf(header, "extern const uint8_t %sBitmap[%u];\n\n", name, count);
+	fprintf(header, "#define %sPalLen 512\n", name);
+	fprintf(header, "extern const uint16_t %sPal[256];\n", name);
+	fclose(header);
+	
+	FILE *source = OpenOutput(dir, name, "c");
+	fprintf(source, "#include <stdint.h>\n\n");
+	fprintf(source, "const uint16_t %sPal[256] =\n{", name);
+	
+	for (uint32_t i = 0; i < 256; i++)
+	{
+		uint32_t rgb = palette[i];
+		uint32_t bgr555 = ((rgb & 0xFF) >> 3) << 10 | (((rgb >> 8) & 0xFF) >> 3) << 5 | (rgb >> 19);
+		fprintf(source, "%s0x%04X,", (i & 7) ? " " : "\n\t", bgr555);
+	}
+	
+	fprintf(source, "\n};\n\n");
+	fprintf(source, "const uint8_t %sBitmap[%u] __attribute__((aligned(4))) =\n{", name, count);
+	WriteArray(source, bitmap, count);
+	fclose(source);
+	
+	FILE *raw = OpenOutput(dir, name, "img.bin");
+	fwrite(bitmap, 1, count, raw);
+	fclose(raw);
+	
+	free(bitmap);
+	free(colours);
+	free(pixels);
+	free(data);
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc != 5)
+	{
+		fprintf(stderr, "usage: %s bin|bmp <file> <name> <dir>\n", argv[0]);
+		return 1;
+	}
+	
+	if (strcmp(argv[1], "bin") == 0)
+		ConvertBinary(argv[2], argv[3], argv[4]);
+	else if (strcmp(argv[1], "bmp") == 0)
+		ConvertBitmap(argv[2], argv[3], argv[4]);
+	else
+	{
+		fprintf(stderr, "%s: unknown mode %s\n", argv[0], argv[1]);
+		return 1;
+	}
+	
+	return 0;
+}
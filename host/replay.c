@@ -0,0 +1,161 @@
+// Eternal Horror
+// Copyright(C) 2020 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// Input recording and replay for the host build, see demo.h. -r records a
+// level played by the key script into a file in the same format as the SRAM
+// recordings of DEMO=1, without -r the file is replayed. Replay prints the
+// per-tick hashes to stderr and exits non-zero if the game diverged.
+
+#include <gba_input.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "demo.h"
+#include "host.h"
+
+static const char *defaultScript =
+	"64 LEFT\n"
+	"30 UP\n"
+	"20 A\n"
+	"32 RIGHT\n"
+	"30 UP+L\n"
+	"64 RIGHT\n"
+	"30 DOWN\n"
+	"30 UP+R\n";
+
+static void Tick()
+{
+	ReadInput();
+	Update();
+	DemoEndTick();
+	Render();
+	FlipPage();
+}
+
+static void Usage(const char *name)
+{
+	fprintf(stderr, "usage: %s -r file [-n ticks] [-l level] [-s script] [-x seed]\n", name);
+	fprintf(stderr, "       %s file\n", name);
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t numTicks = 3600;
+	uint32_t recordLevel = 1;
+	uint32_t seed = 1;
+	uint32_t record = 0;
+	const char *scriptPath = NULL;
+	const char *path = NULL;
+	
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-r") == 0)
+		{
+			record = 1;
+			continue;
+		}
+		
+		if (argv[i][0] != '-')
+		{
+			path = argv[i];
+			continue;
+		}
+		
+		if (i + 1 >= argc)
+			Usage(argv[0]);
+		
+		if (strcmp(argv[i], "-n") == 0)
+			numTicks = strtoul(argv[++i], NULL, 0);
+		else if (strcmp(argv[i], "-l") == 0)
+			recordLevel = strtoul(argv[++i], NULL, 0);
+		else if (strcmp(argv[i], "-s") == 0)
+			scriptPath = argv[++i];
+		else if (strcmp(argv[i], "-x") == 0)
+			seed = strtoul(argv[++i], NULL, 0);
+		else
+			Usage(argv[0]);
+	}
+	
+	if (!path || numTicks == 0 || numTicks > DEMO_MAX_TICKS || recordLevel == 0 || recordLevel > numLevels)
+		Usage(argv[0]);
+	
+	Init();
+	
+	if (record)
+	{
+		if (scriptPath)
+		{
+			if (!HostLoadScript(scriptPath))
+			{
+				fprintf(stderr, "%s: cannot load script %s\n", argv[0], scriptPath);
+				return 1;
+			}
+		}
+		else
+			HostParseScript(defaultScript);
+		
+		SeedRandom(seed);
+		level = recordLevel;
+		state = 1;
+		health = 100;
+		DemoStartRecording();
+		
+		for (uint32_t i = 0; i < numTicks; i++)
+			Tick();
+		
+		FILE *file = fopen(path, "wb");
+		
+		if (!file || fwrite(demoData, 1, sizeof(demoheader_t) + demoTick * sizeof(demotick_t), file) == 0)
+		{
+			perror(path);
+			return 1;
+		}
+		
+		fclose(file);
+		printf("recorded %u ticks of level %u\n", demoTick, recordLevel);
+		
+		return 0;
+	}
+	
+	FILE *file = fopen(path, "rb");
+	
+	if (!file)
+	{
+		perror(path);
+		return 1;
+	}
+	
+	fread(demoData, 1, sizeof(demoData), file);
+	fclose(file);
+	
+	if (!DemoStartPlayback())
+	{
+		fprintf(stderr, "%s: %s is not a recording\n", argv[0], path);
+		return 1;
+	}
+	
+	while (demoMode == DEMO_PLAYBACK)
+		Tick();
+	
+	if (demoDiverged)
+	{
+		printf("diverged at tick %u of %u\n", demoDiverged - 1, demoTicks);
+		return 1;
+	}
+	
+	printf("all %u ticks match\n", demoTicks);
+	
+	return 0;
+}
@@ -0,0 +1,39 @@
+// Eternal Horror
+// Copyright(C) 2020 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#ifndef __BLIT_H__
+#define __BLIT_H__
+
+#include <stdint.h>
+
+// Block fills and copies
+//
+// BlitFill and BlitCopy move count halfwords, BlitFillRows fills height rows
+// of width halfwords that are stride halfwords apart, as one block when the
+// rows touch. The word aligned middle of a block goes a word at a time:
+// CpuFastSet takes the multiple of 8 words of one of at least BLIT_FAST_MIN
+// words and DMA3 the rest. A halfword edge off word alignment, and any block
+// shorter than BLIT_DMA_MIN halfwords, is written by the CPU. BlitCopy needs
+// source and dest equally aligned for words and copies halfwords with DMA3
+// otherwise.
+//
+// Nothing is written a byte at a time, so they work on VRAM and palette RAM.
+
+#define BLIT_DMA_MIN 16
+#define BLIT_FAST_MIN 64
+
+void BlitFill(uint16_t *p, uint16_t pixel, uint32_t count);
+void BlitFillRows(uint16_t *p, uint16_t pixel, uint32_t width, uint32_t height, uint32_t stride);
+void BlitCopy(void *dest, const void *source, uint32_t count);
+
+#endif
@@ -0,0 +1,25 @@
+// Eternal Horror
+// Copyright(C) 2020 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#ifndef __DEBUG_H__
+#define __DEBUG_H__
+
+// Debug output
+//
+// DebugLog prints one line to the mGBA debug log (Tools > View Logs) when the
+// game runs in mGBA and does nothing on hardware. The host build prints to
+// stderr instead. Lines longer than 255 characters are cut off.
+
+void DebugLog(const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+#endif
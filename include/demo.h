@@ -0,0 +1,91 @@
+// Eternal Horror
+// Copyright(C) 2020 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#ifndef __DEMO_H__
+#define __DEMO_H__
+
+#include <stdint.h>
+
+// Input recording and replay
+//
+// Update() reads the keys from inputHeld and inputDown, which ReadInput()
+// fills once per tick, from the keypad or from a recording. DEMO 1 records
+// every tick from power on into SRAM, DEMO 2 replays the recording in SRAM.
+//
+// A recording is a header with the level, state, health and PRNG seed it
+// started from, then one entry per tick: the keys held and the low half of
+// StateHash() after that tick's Update(). keysDown is not stored, it is the
+// keys held that were not held on the tick before. Replay feeds the keys back,
+// sends "tick,hash" for every tick to the debug log (see debug.h) and reports
+// the first tick whose hash differs from the recorded one.
+//
+// The host build keeps the recording in demoData instead of SRAM, see
+// host/replay.c.
+
+#ifndef DEMO
+#define DEMO 0
+#endif
+
+#define DEMO_SIZE 32768
+#define DEMO_MAGIC 0x4D444845
+
+#define DEMO_OFF 0
+#define DEMO_RECORD 1
+#define DEMO_PLAYBACK 2
+
+typedef struct
+{
+	uint32_t magic;
+	uint32_t seed;
+	uint32_t level;
+	uint32_t state;
+	int32_t health;
+	uint32_t ticks;
+	uint16_t keys;
+	uint16_t pad;
+} demoheader_t;
+
+typedef struct
+{
+	uint16_t keys;
+	uint16_t hash;
+} demotick_t;
+
+#define DEMO_MAX_TICKS ((DEMO_SIZE - sizeof(demoheader_t)) / sizeof(demotick_t))
+
+extern uint16_t inputHeld;
+extern uint16_t inputDown;
+
+extern uint32_t demoMode;
+extern uint32_t demoTick;
+extern uint32_t demoTicks;
+extern uint32_t demoDiverged;
+
+#ifdef HOST
+extern uint8_t demoData[DEMO_SIZE];
+#endif
+
+// Game state, from main.c
+extern uint32_t randomState;
+
+uint32_t Random();
+void SeedRandom(uint32_t seed);
+uint32_t StateHash();
+
+void ReadInput();
+void DemoStartRecording();
+uint32_t DemoStartPlayback();
+void DemoEndTick();
+void DemoStop();
+
+#endif
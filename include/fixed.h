@@ -16,6 +16,8 @@
 #ifndef __FIXED_H__
 #define __FIXED_H__
 
+#include "view.h"
+
 #define FRACBITS 16
 #define FRACUNIT (1 << FRACBITS)
 
@@ -25,10 +27,48 @@
 typedef int32_t fixed_t;
 typedef uint32_t angle_t;
 
+// Multiplies are inlined so ARM code gets a single smull. fixedMulFast drops
+// the overflow check and may only be used where the product is known to fit,
+// fixedMulSat clamps to INT_MIN/INT_MAX like fixedMul, which stays out of line
+// in IWRAM for Thumb callers.
+
+static inline __attribute__((always_inline)) fixed_t fixedMulFast(fixed_t a, fixed_t b)
+{
+#if defined(__arm__) && !defined(__thumb__)
+	int32_t lo, hi;
+	__asm__("smull %0, %1, %2, %3" : "=&r" (lo), "=&r" (hi) : "r" (a), "r" (b));
+	return (int32_t) ((uint32_t) lo >> FRACBITS | (uint32_t) hi << (32 - FRACBITS));
+#else
+	return (fixed_t) (((int64_t) a * (int64_t) b) >> FRACBITS);
+#endif
+}
+
+static inline __attribute__((always_inline)) fixed_t fixedMulSat(fixed_t a, fixed_t b)
+{
+#if defined(__arm__) && !defined(__thumb__)
+	int32_t lo, hi;
+	__asm__("smull %0, %1, %2, %3" : "=&r" (lo), "=&r" (hi) : "r" (a), "r" (b));
+	if ((hi >> (FRACBITS - 1)) != (hi >> 31))
+		return hi < 0 ? INT32_MIN : INT32_MAX;
+	return (int32_t) ((uint32_t) lo >> FRACBITS | (uint32_t) hi << (32 - FRACBITS));
+#else
+	int64_t result = ((int64_t) a * (int64_t) b) >> FRACBITS;
+	return (result < INT32_MIN ? INT32_MIN : result > INT32_MAX ? INT32_MAX : (fixed_t) result);
+#endif
+}
+
 fixed_t fixedSin(angle_t a);
 fixed_t fixedCos(angle_t a);
 fixed_t fixedTan(angle_t a);
 fixed_t fixedCot(angle_t a);
 fixed_t fixedMul(fixed_t a, fixed_t b);
+fixed_t fixedRecip(fixed_t a);
+fixed_t fixedDiv(fixed_t a, fixed_t b);
+
+// Projection: texture step per texel for every even height 2..MAX_HEIGHT,
+// indexed by (MAX_HEIGHT - height) >> 1, and the height of a wall or sprite
+// at a given distance, see view.h
+extern const fixed_t scalarTable[MAX_HEIGHT / 2];
+uint32_t projectHeight(fixed_t d);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,65 @@
+// Eternal Horror
+// Copyright(C) 2020 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#ifndef __HUD_H__
+#define __HUD_H__
+
+#include <stdint.h>
+
+#include "view.h"
+
+// HUD
+//
+// The weapon hand and the health bar are OBJs over the view rather than
+// pixels drawn into every page. HudInit() loads the two hand frames,
+// scaled to their size on screen, and four health bar tiles into the OBJ
+// VRAM the bitmap modes leave free, once. HudUpdate() is given what the HUD
+// shows for the frame Render() is drawing and only rebuilds its copy of the
+// HUD's OAM entries when that changed; HudCommit() copies them to OAM after
+// the VBlank the frame's page is flipped in, so the HUD changes with it. With
+// TRIPLE_BUFFER the page is flipped by the VBlank interrupt some time after
+// the next frame has started, so HudQueue() keeps the frame's entries along
+// with its page and HudCommitQueued() copies them from the interrupt.
+//
+// The hand's colour key texels are OBJ colour 0, transparent, and its texels
+// of palette index 0 use the key's entry of the OBJ palette instead.
+//
+// The HUD is laid out in view texels: the hand frames, HUD_HAND_WIDTH x
+// HUD_HAND_HEIGHT side by side at HUD_HAND in graphicsBitmap, in the bottom
+// right corner, and the bar 2 texels tall and up to HUD_BAR_WIDTH wide,
+// centred along the bottom. The bar is a little over half the view wide, in
+// OBJs of 4 texels each. Like walls and sprites, the hand keeps its size on
+// screen at either VIEW_SCALE, 2 screen pixels a texel, so at VIEW_SCALE 1
+// each of its texels covers HUD_HAND_SCALE = 2 view texels each way.
+
+#define HUD_HAND 49152
+#define HUD_HAND_WIDTH 25
+#define HUD_HAND_HEIGHT 26
+#define HUD_HAND_SCALE (2 / VIEW_SCALE)
+#define HUD_HAND_X (VIEW_WIDTH - HUD_HAND_WIDTH * HUD_HAND_SCALE)
+#define HUD_HAND_Y (VIEW_HEIGHT - HUD_HAND_HEIGHT * HUD_HAND_SCALE)
+
+#define HUD_BAR_WIDTH ((VIEW_WIDTH * 8 / 15) & ~3)
+#define HUD_BAR_X ((VIEW_WIDTH - HUD_BAR_WIDTH) >> 1)
+#define HUD_BAR_Y (VIEW_HEIGHT - 4)
+
+#define HUD_BAR_OBJS (HUD_BAR_WIDTH / 4)
+#define HUD_OBJS (1 + HUD_BAR_OBJS)
+
+void HudInit();
+void HudUpdate(uint32_t visible, uint32_t handFrame, uint32_t barWidth);
+void HudCommit();
+void HudQueue();
+void HudCommitQueued();
+
+#endif
@@ -0,0 +1,269 @@
+// Eternal Horror
+// Copyright(C) 2020 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#ifndef __KERNELS_H__
+#define __KERNELS_H__
+
+// Framebuffer
+//
+// COMPACT_FRAMEBUFFER 0 draws the view (see view.h) into mode 4 at twice its
+// size, every texel written to both bytes of a halfword on two rows. 1 draws
+// it once into mode 5, one halfword colour per texel, and lets the BG2 affine
+// registers scale it by VIEW_SCALE, a quarter of the bytes written to VRAM at
+// 2x. A mode 5 page is 160x128, so the default view only takes half of it.
+//
+// ROW_STRIDE is the distance in halfwords between bitmap rows, ROW_REPEAT the
+// bitmap rows per view row, PAGE_ROWS the bitmap rows of a page and
+// VIEW_STRIDE the distance between view rows.
+
+#include "view.h"
+
+#ifndef COMPACT_FRAMEBUFFER
+#define COMPACT_FRAMEBUFFER 0
+#endif
+
+#if COMPACT_FRAMEBUFFER
+#define ROW_STRIDE 160
+#define ROW_REPEAT 1
+#define PAGE_ROWS 128
+#else
+#define ROW_STRIDE 120
+#define ROW_REPEAT 2
+#define PAGE_ROWS 160
+#endif
+
+#define VIEW_STRIDE (ROW_STRIDE * ROW_REPEAT)
+
+#if !COMPACT_FRAMEBUFFER && VIEW_SCALE != 2
+#error "mode 4 draws a texel as a halfword, so it needs VIEW_SCALE 2"
+#endif
+
+#if COMPACT_FRAMEBUFFER && (VIEW_WIDTH > 160 || VIEW_HEIGHT > 128)
+#error "a mode 5 page holds at most 160x128 texels"
+#endif
+
+// Pages
+//
+// Render() draws into yTable[page], one of PAGES pages. TRIPLE_BUFFER 0 has
+// the two bitmap pages and main() flips between them at the VBlank after
+// each frame. 1 has three, and needs COMPACT_FRAMEBUFFER and a view that fits
+// twice into a mode 5 page: pages 0 and 1 are the top of the two bitmap
+// pages and page 2 the rows under page 0's view, shown by scrolling BG2 down
+// to them. A finished page is queued and the VBlank interrupt shows the
+// newest one, while the next frame is drawn into the third, see main().
+//
+// PAGE_BITMAP is the bitmap page a page is in and PAGE_ROW its first row.
+
+#ifndef TRIPLE_BUFFER
+#define TRIPLE_BUFFER 0
+#endif
+
+#if TRIPLE_BUFFER
+#if !COMPACT_FRAMEBUFFER || VIEW_HEIGHT * 2 > PAGE_ROWS
+#error "triple buffering needs COMPACT_FRAMEBUFFER and a view at most 64 texels tall"
+#endif
+
+#define PAGES 3
+#else
+#define PAGES 2
+#endif
+
+#define PAGE_BITMAP(page) ((page) & 1)
+#define PAGE_ROW(page) ((page) >> 1 ? VIEW_HEIGHT : 0)
+
+// Lighting
+//
+// LIGHTING 1 fades walls, floors, ceilings and sprites into FOG_COLOR (a
+// palette index) with their distance, through LIGHT_LEVELS light tables, see
+// light.h. FOG_DISTANCE map cells away everything is the fog colour, so rays
+// stop there and walls beyond it are filled with the fog colour. 0 draws
+// everything at full brightness.
+
+#ifndef LIGHTING
+#define LIGHTING 0
+#endif
+
+#ifndef LIGHT_LEVELS
+#define LIGHT_LEVELS 16
+#endif
+
+#ifndef FOG_DISTANCE
+#define FOG_DISTANCE 8
+#endif
+
+#ifndef FOG_COLOR
+#define FOG_COLOR 0x00
+#endif
+
+#if LIGHT_LEVELS & (LIGHT_LEVELS - 1) || LIGHT_LEVELS > 64
+#error "LIGHT_LEVELS must be a power of 2 up to 64"
+#endif
+
+#if FOG_DISTANCE < 2 || FOG_DISTANCE > 64
+#error "FOG_DISTANCE must be from 2 to 64 map cells"
+#endif
+
+#ifndef __ASSEMBLER__
+
+#include "fixed.h"
+
+// PIXEL is the halfword drawn for a palette index, PUT_PIXEL draws it at p
+// and PUT_PIXEL_PAIR at p and p + 1 with one word store, p word aligned. A
+// plane texel holds the floor and ceiling, as palette indices in mode 4 and
+// as colours in mode 5.
+//
+// LIGHT_PIXEL is the halfword drawn for a texel of a wall or sprite, looked
+// up in lightTable, the light table of the column, plane row or sprite being
+// drawn, with LIGHTING. A light table holds colours in mode 5 and palette
+// indices in mode 4, and lit plane texels are palette indices in both.
+
+typedef uint32_t __attribute__((may_alias)) pixelpair_t;
+
+#if COMPACT_FRAMEBUFFER
+extern uint16_t colorTable[256];
+
+typedef uint16_t lighttable_t;
+
+#define PIXEL(color) colorTable[color]
+#define LIT_PIXEL(light, color) (light)[color]
+#define PUT_PIXEL(p, pixel) (*(p) = (pixel))
+#define PUT_PIXEL_PAIR(p, pixel) (*(pixelpair_t *) (p) = (pixel) * 0x10001u)
+#else
+typedef uint8_t lighttable_t;
+
+#define PIXEL(color) ((color) << 8 | (color))
+#define LIT_PIXEL(light, color) PIXEL((light)[color])
+#define PUT_PIXEL(p, pixel) (*(p) = *((p) + ROW_STRIDE) = (pixel))
+#define PUT_PIXEL_PAIR(p, pixel) (*(pixelpair_t *) (p) = *(pixelpair_t *) ((p) + ROW_STRIDE) = (pixel) * 0x10001u)
+#endif
+
+#if LIGHTING
+extern const lighttable_t *lightTable;
+
+typedef uint16_t planetexel_t;
+
+#define LIGHT_PIXEL(color) LIT_PIXEL(lightTable, color)
+#define PLANE_TEXEL(floor, ceiling) ((ceiling) << 8 | (floor))
+#define FLOOR_PIXEL(texel) LIGHT_PIXEL((texel) & 0xFF)
+#define CEILING_PIXEL(texel) LIGHT_PIXEL((texel) >> 8)
+#elif COMPACT_FRAMEBUFFER
+typedef uint32_t planetexel_t;
+
+#define LIGHT_PIXEL(color) PIXEL(color)
+#define PLANE_TEXEL(floor, ceiling) (colorTable[ceiling] << 16 | colorTable[floor])
+#define FLOOR_PIXEL(texel) ((uint16_t) (texel))
+#define CEILING_PIXEL(texel) ((texel) >> 16)
+#else
+typedef uint16_t planetexel_t;
+
+#define LIGHT_PIXEL(color) PIXEL(color)
+#define PLANE_TEXEL(floor, ceiling) ((ceiling) << 8 | (floor))
+#define FLOOR_PIXEL(texel) PIXEL((texel) & 0xFF)
+#define CEILING_PIXEL(texel) PIXEL((texel) >> 8)
+#endif
+
+// Column and span kernels
+//
+// DrawWallColumn draws count + 1 texels down a column, stepping the texture
+// offset by scalar. DrawPlaneSpan draws count + 1 floor pixels rightwards
+// from p1 and the matching ceiling pixels from p2, reading both from one
+// 64x64 texture of plane texels. DrawWallColumnWide draws the column two
+// pixels wide, for the columns of a reduced resolution, in C only.
+//
+// ASM_KERNELS picks the hand-scheduled ARM versions in kernels.s over the C
+// references in main.c; the host build always uses C. KERNEL_BENCH links both
+// and times them against each other at startup, see BenchKernels().
+
+#ifndef ASM_KERNELS
+#ifdef HOST
+#define ASM_KERNELS 0
+#else
+#define ASM_KERNELS 1
+#endif
+#endif
+
+#ifndef KERNEL_BENCH
+#define KERNEL_BENCH 0
+#endif
+
+void DrawWallColumnC(uint16_t *p, const uint8_t *texture, fixed_t textureOffsetY, fixed_t scalar, uint32_t count);
+void DrawPlaneSpanC(uint16_t *p1, uint16_t *p2, const planetexel_t *texture, fixed_t x, fixed_t y, fixed_t stepX, fixed_t stepY, uint32_t count);
+void DrawWallColumnArm(uint16_t *p, const uint8_t *texture, fixed_t textureOffsetY, fixed_t scalar, uint32_t count);
+void DrawPlaneSpanArm(uint16_t *p1, uint16_t *p2, const planetexel_t *texture, fixed_t x, fixed_t y, fixed_t stepX, fixed_t stepY, uint32_t count);
+
+void DrawWallColumnWide(uint16_t *p, const uint8_t *texture, fixed_t textureOffsetY, fixed_t scalar, uint32_t count);
+
+#if ASM_KERNELS
+#define DrawWallColumn DrawWallColumnArm
+#define DrawPlaneSpan DrawPlaneSpanArm
+#else
+#define DrawWallColumn DrawWallColumnC
+#define DrawPlaneSpan DrawPlaneSpanC
+#endif
+
+// Draw kernel variants, see main.c. spriteKernels[clipped][damage] is the
+// sprite variant for a sprite cut off by the view or not and flashing or not.
+// FillRect fills a rectangle of the view through the blit layer, see blit.h.
+
+typedef void (*spritekernel_t)(uint32_t spriteFrame, int32_t spriteX, int32_t spriteY, uint32_t spriteSize, fixed_t spriteDistance);
+
+void DrawWallSliceFit(const uint8_t *texture, uint32_t textureOffsetX, int32_t wallX, int32_t wallY, uint32_t wallHeight);
+void DrawWallSliceClip(const uint8_t *texture, uint32_t textureOffsetX, int32_t wallX, int32_t wallY, uint32_t wallHeight);
+void DrawWallSliceFitWide(const uint8_t *texture, uint32_t textureOffsetX, int32_t wallX, int32_t wallY, uint32_t wallHeight);
+void DrawWallSliceClipWide(const uint8_t *texture, uint32_t textureOffsetX, int32_t wallX, int32_t wallY, uint32_t wallHeight);
+void DrawSpriteFit(uint32_t spriteFrame, int32_t spriteX, int32_t spriteY, uint32_t spriteSize, fixed_t spriteDistance);
+void DrawSpriteFitDamage(uint32_t spriteFrame, int32_t spriteX, int32_t spriteY, uint32_t spriteSize, fixed_t spriteDistance);
+void DrawSpriteClip(uint32_t spriteFrame, int32_t spriteX, int32_t spriteY, uint32_t spriteSize, fixed_t spriteDistance);
+void DrawSpriteClipDamage(uint32_t spriteFrame, int32_t spriteX, int32_t spriteY, uint32_t spriteSize, fixed_t spriteDistance);
+void DrawGraphicOpaque(const uint8_t *graphic, int32_t srcX, int32_t srcY, int32_t dstX, int32_t dstY, int32_t width, int32_t height);
+void DrawGraphicKeyed(const uint8_t *graphic, int32_t srcX, int32_t srcY, int32_t dstX, int32_t dstY, int32_t width, int32_t height);
+void FillRect(int32_t x, int32_t y, int32_t width, int32_t height, uint8_t color);
+
+extern const spritekernel_t spriteKernels[2][2];
+
+#ifdef HOST
+// A draw kernel call Render() made, recorded for ./bench -k. variant is
+// wide << 1 | clipped of a wall slice, clipped << 1 | damage of a sprite,
+// the keyed flag of a graphic and the screen state a rectangle was filled
+// in. data is the texture or graphic and args the rest of the parameters in
+// order.
+
+#define KERNEL_WALL_SLICE 0
+#define KERNEL_SPRITE 1
+#define KERNEL_GRAPHIC 2
+#define KERNEL_RECT 3
+
+typedef struct
+{
+	uint8_t kernel;
+	uint8_t variant;
+	uint8_t page;
+	const void *data;
+	int32_t args[6];
+} kernelcall_t;
+
+extern kernelcall_t *kernelCalls;
+extern uint32_t kernelCallCount;
+extern uint32_t kernelCallLimit;
+
+// The generic kernels, testing at run time what the variants are built for,
+// and the pixel at a time DrawRect that FillRect replaced
+void DrawWallSlice(const uint8_t *texture, uint32_t textureOffsetX, int32_t wallX, int32_t wallY, uint32_t wallHeight);
+void DrawSprite(uint32_t spriteFrame, int32_t spriteX, int32_t spriteY, uint32_t spriteSize, fixed_t spriteDistance, uint32_t spriteDamage);
+void DrawGraphic(const uint8_t *graphic, int32_t srcX, int32_t srcY, int32_t dstX, int32_t dstY, int32_t width, int32_t height);
+void DrawRect(int32_t x, int32_t y, int32_t width, int32_t height, uint8_t color);
+#endif
+
+#endif
+
+#endif
@@ -0,0 +1,47 @@
+// Eternal Horror
+// Copyright(C) 2020 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#ifndef __LIGHT_H__
+#define __LIGHT_H__
+
+#include <stdint.h>
+
+#include "fixed.h"
+#include "kernels.h"
+
+// Light tables
+//
+// With LIGHTING, lightTables[l] is what a palette index is drawn as at light
+// level l: its colour l / LIGHT_LEVELS of the way to FOG_COLOR's, as that
+// colour in mode 5 and as the palette index nearest to it in mode 4. Level
+// LIGHT_LEVELS is the fog colour alone. LightInit() builds them from
+// graphicsPal once; in mode 4 that searches the palette 256 times a level.
+//
+// A distance along the view is at level distance / LIGHT_BAND, one every
+// FOG_DISTANCE / LIGHT_LEVELS map cells, up to FOG_DEPTH, and in the fog
+// from there on. LightTable() is the table for a distance, and the kernels
+// draw through lightTable, see kernels.h.
+
+#define FOG_DEPTH ((fixed_t) FOG_DISTANCE << 22)
+#define LIGHT_BAND (FOG_DEPTH / LIGHT_LEVELS)
+
+extern lighttable_t lightTables[LIGHT_LEVELS + 1][256];
+
+void LightInit();
+
+static inline const lighttable_t *LightTable(fixed_t distance)
+{
+	return lightTables[distance < FOG_DEPTH ? (uint32_t) distance / LIGHT_BAND : LIGHT_LEVELS];
+}
+
+#endif
@@ -0,0 +1,75 @@
+// Eternal Horror
+// Copyright(C) 2020 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#ifndef __PROFILE_H__
+#define __PROFILE_H__
+
+// Frame profiler
+//
+// PROFILER 1 times every frame in CPU cycles with timers 2 and 3 cascaded
+// into one 32-bit counter. ProfileMark charges the cycles since the previous
+// mark or ProfileBegin to a stage. ProfileEndFrame keeps the frame in a ring
+// buffer of PROFILE_FRAMES and sends it to the debug log as a CSV line, see
+// debug.h. B toggles an overlay that prints the ring buffer's averages in
+// thousands of cycles into the border under the view.
+//
+// main() calls ProfileBegin once at the top of each frame, so the stages add
+// up to the whole frame: the overlay is charged to the HUD, and the page flip
+// with its OAM and HUD commit to the vblank wait. Only ProfileEndFrame itself
+// falls between frames, on purpose, so the profiler's own CSV logging does
+// not show up as game time.
+//
+// The host build counts nanoseconds converted to GBA cycles instead.
+//
+// ProfileStartClock and ProfileClock are the cycle counter on its own and are
+// available whether PROFILER is set or not.
+
+#ifndef PROFILER
+#define PROFILER 0
+#endif
+
+#define PROFILE_UPDATE 0
+#define PROFILE_RAYS 1
+#define PROFILE_PLANES 2
+#define PROFILE_SPRITES 3
+#define PROFILE_HUD 4
+#define PROFILE_VBLANK 5
+#define PROFILE_STAGES 6
+
+#define PROFILE_FRAMES 64
+
+typedef struct
+{
+	uint32_t cycles[PROFILE_STAGES];
+} profile_t;
+
+extern profile_t profileFrames[PROFILE_FRAMES];
+extern uint32_t profileFrame;
+extern uint32_t profileOverlay;
+
+void ProfileStartClock();
+uint32_t ProfileClock();
+
+void ProfileInit();
+void ProfileBegin();
+void ProfileMark(uint32_t stage);
+void ProfileEndFrame();
+uint32_t ProfileDrawOverlay(uint16_t *p);
+
+#if PROFILER
+#define PROFILE_MARK(stage) ProfileMark(stage)
+#else
+#define PROFILE_MARK(stage)
+#endif
+
+#endif
@@ -0,0 +1,32 @@
+// Eternal Horror
+// Copyright(C) 2020 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#ifndef __SCALERS_H__
+#define __SCALERS_H__
+
+#include "view.h"
+
+// Compiled wall scalers
+//
+// scalerTable[wallHeight >> 1] draws a wall column of that height with its
+// texel offsets unrolled, p being the first visible row and texture the
+// texture column, for the VIEW_HEIGHT of the build. The table and scalers
+// are generated by tools/mkscalers.c for as many heights as fit in
+// SCALER_BUDGET bytes of IWRAM, see the Makefile. Heights without a scaler
+// are NULL.
+
+typedef void (*scaler_t)(uint16_t *p, const uint8_t *texture);
+
+extern const scaler_t scalerTable[MAX_HEIGHT / 2 + 1];
+
+#endif
@@ -0,0 +1,43 @@
+// Eternal Horror
+// Copyright(C) 2020 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#ifndef __SPRITES_H__
+#define __SPRITES_H__
+
+#include <stdint.h>
+
+// Run-length encoded sprites
+//
+// The enemy and health frames are 64x64 in graphicsBitmap, a column every 64
+// bytes, starting at SPRITE_OFFSET and 4096 bytes apart. tools/mksprites.c
+// keeps only their opaque texels: column c of frame f is the runs from
+// spriteColumns[f * 65 + c] up to spriteColumns[f * 65 + c + 1] in
+// spriteRuns, each a row it starts on, its length and where its texels are
+// in spriteTexels. Rows of the colour key are in no run.
+
+#define SPRITE_FRAMES 6
+#define SPRITE_OFFSET 24576
+#define SPRITE_COLOR_KEY 0x0C
+
+typedef struct
+{
+	uint8_t start;
+	uint8_t length;
+	uint16_t texel;
+} spriterun_t;
+
+extern const uint16_t spriteColumns[SPRITE_FRAMES * 65];
+extern const spriterun_t spriteRuns[];
+extern const uint8_t spriteTexels[];
+
+#endif
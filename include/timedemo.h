@@ -0,0 +1,52 @@
+// Eternal Horror
+// Copyright(C) 2020 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#ifndef __TIMEDEMO_H__
+#define __TIMEDEMO_H__
+
+#include <stdint.h>
+
+// Timedemo
+//
+// Timedemo() enters every level the way the exit tile does, see NextLevel(),
+// and flies the camera along a fixed path of waypoints through it: doors are
+// waited at until they open, enemies are flown through and every level has
+// 360 degree spins and long looks down its corridors. The player cannot die
+// and no keys are pressed, so every build draws the same frames.
+//
+// Each frame is Update() and Render() timed with ProfileClock(), see
+// profile.h. The results go to the debug log (see debug.h) as CSV: the
+// minimum, average and maximum cycles per level, then the five slowest frames
+// of each level with the camera pose they were drawn from, x and y in map
+// units.
+//
+// TIMEDEMO 1 runs it at power on before the game starts. The host build runs
+// it with ./bench -t.
+
+#ifndef TIMEDEMO
+#define TIMEDEMO 0
+#endif
+
+#define TIMEDEMO_WORST 5
+
+typedef struct
+{
+	uint8_t gridX;
+	uint8_t gridY;
+	int16_t angle;
+	uint16_t tics;
+} waypoint_t;
+
+void Timedemo();
+
+#endif
@@ -0,0 +1,72 @@
+// Eternal Horror
+// Copyright(C) 2020 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#ifndef __VIEW_H__
+#define __VIEW_H__
+
+// View size
+//
+// The view is VIEW_WIDTH x VIEW_HEIGHT texels, each drawn VIEW_SCALE x
+// VIEW_SCALE screen pixels, in the middle of the 240x160 screen. Mode 4 can
+// only draw a texel as a halfword, so it needs VIEW_SCALE 2, and a mode 5
+// page holds at most 160x128 texels, see kernels.h. The default 120x64 at 2
+// leaves a 16 pixel border above and below, 120x80 fills the screen.
+//
+// Walls and sprites are projected VIEW_FOCAL texels per unit of tangent, the
+// same 128 screen pixels at either scale, so the scale only changes how
+// finely the view is drawn and the size how much of the world it shows. At
+// VIEW_SCALE 1 walls can be up to MAX_HEIGHT = 1024 texels tall, and as the
+// rays are 512 to a turn, neighbouring columns share rays.
+//
+// The width is a multiple of 8, for the sprite rejection runs of zBufferMax,
+// and the height is even, as every wall is. Both are at least 64 to hold the
+// 64x64 screens.
+
+#ifndef VIEW_WIDTH
+#define VIEW_WIDTH 120
+#endif
+
+#ifndef VIEW_HEIGHT
+#define VIEW_HEIGHT 64
+#endif
+
+#ifndef VIEW_SCALE
+#define VIEW_SCALE 2
+#endif
+
+#if VIEW_SCALE != 1 && VIEW_SCALE != 2
+#error "VIEW_SCALE must be 1 or 2"
+#endif
+
+#if VIEW_WIDTH % 8 || VIEW_WIDTH < 64 || VIEW_WIDTH * VIEW_SCALE > 240
+#error "VIEW_WIDTH must be a multiple of 8 from 64 to 240 / VIEW_SCALE"
+#endif
+
+#if VIEW_HEIGHT % 2 || VIEW_HEIGHT < 64 || VIEW_HEIGHT * VIEW_SCALE > 160
+#error "VIEW_HEIGHT must be even and from 64 to 160 / VIEW_SCALE"
+#endif
+
+#if VIEW_SCALE == 1
+#define PROJECTION_SHIFT 1
+#else
+#define PROJECTION_SHIFT 0
+#endif
+
+#define VIEW_FOCAL (64 << PROJECTION_SHIFT)
+#define MAX_HEIGHT (512 << PROJECTION_SHIFT)
+
+// The screen pixel the view's top left texel is drawn at
+#define VIEW_SCREEN_X ((SCREEN_WIDTH - VIEW_WIDTH * VIEW_SCALE) >> 1)
+#define VIEW_SCREEN_Y ((SCREEN_HEIGHT - VIEW_HEIGHT * VIEW_SCALE) >> 1)
+
+#endif
@@ -0,0 +1,116 @@
+// Eternal Horror
+// Copyright(C) 2020 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#include <gba_base.h>
+#include <gba_dma.h>
+#include <gba_systemcalls.h>
+#include <stdint.h>
+
+#include "blit.h"
+
+// Both CpuFastSet and a DMA with a fixed source read the fill word from
+// memory, so it is stored here first
+static volatile uint32_t fillWord;
+
+// Fills (fill set) or copies count words, see blit.h
+static void IWRAM_CODE ARM_CODE BlitWords(uint32_t *dest, const volatile uint32_t *source, uint32_t count, uint32_t fill)
+{
+	if (count >= BLIT_FAST_MIN)
+	{
+		uint32_t fast = count & ~7;
+		
+		CpuFastSet((const void *) source, dest, fast | (fill ? FILL : 0));
+		
+		dest += fast;
+		
+		if (!fill)
+			source += fast;
+		
+		count -= fast;
+	}
+	
+	if (count)
+		DMA3COPY(source, dest, DMA32 | DMA_DST_INC | (fill ? DMA_SRC_FIXED : DMA_SRC_INC) | count);
+}
+
+void IWRAM_CODE ARM_CODE BlitFill(uint16_t *p, uint16_t pixel, uint32_t count)
+{
+	if (count < BLIT_DMA_MIN)
+	{
+		while (count--)
+			*(p++) = pixel;
+		
+		return;
+	}
+	
+	if ((uintptr_t) p & 2)
+	{
+		*(p++) = pixel;
+		count--;
+	}
+	
+	fillWord = pixel << 16 | pixel;
+	BlitWords((uint32_t *) p, &fillWord, count >> 1, 1);
+	
+	if (count & 1)
+		p[count - 1] = pixel;
+}
+
+void IWRAM_CODE ARM_CODE BlitFillRows(uint16_t *p, uint16_t pixel, uint32_t width, uint32_t height, uint32_t stride)
+{
+	if (width == 0 || height == 0)
+		return;
+	
+	if (width == stride)
+	{
+		BlitFill(p, pixel, width * height);
+		return;
+	}
+	
+	do
+	{
+		BlitFill(p, pixel, width);
+		p += stride;
+	} while (--height);
+}
+
+void BlitCopy(void *dest, const void *source, uint32_t count)
+{
+	uint16_t *d = dest;
+	const uint16_t *s = source;
+	
+	if (count < BLIT_DMA_MIN)
+	{
+		while (count--)
+			*(d++) = *(s++);
+		
+		return;
+	}
+	
+	if (((uintptr_t) d ^ (uintptr_t) s) & 2)
+	{
+		DMA3COPY(s, d, DMA16 | DMA_DST_INC | DMA_SRC_INC | count);
+		return;
+	}
+	
+	if ((uintptr_t) d & 2)
+	{
+		*(d++) = *(s++);
+		count--;
+	}
+	
+	BlitWords((uint32_t *) d, (const uint32_t *) s, count >> 1, 0);
+	
+	if (count & 1)
+		d[count - 1] = s[count - 1];
+}
@@ -0,0 +1,62 @@
+// Eternal Horror
+// Copyright(C) 2020 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "debug.h"
+
+#ifdef HOST
+
+void DebugLog(const char *format, ...)
+{
+	va_list args;
+	
+	va_start(args, format);
+	vfprintf(stderr, format, args);
+	va_end(args);
+	fputc('\n', stderr);
+}
+
+#else
+
+#define MGBA_DEBUG_ENABLE *(volatile uint16_t *)0x4FFF780
+#define MGBA_DEBUG_FLAGS *(volatile uint16_t *)0x4FFF700
+#define MGBA_DEBUG_STRING ((char *)0x4FFF600)
+
+#define MGBA_LOG_INFO 3
+#define MGBA_LOG_SEND 0x100
+
+uint32_t debugEnabled = 0;
+
+void DebugLog(const char *format, ...)
+{
+	va_list args;
+	
+	if (!debugEnabled)
+	{
+		MGBA_DEBUG_ENABLE = 0xC0DE;
+		debugEnabled = MGBA_DEBUG_ENABLE == 0x1DEA ? 1 : 2;
+	}
+	
+	if (debugEnabled != 1)
+		return;
+	
+	va_start(args, format);
+	vsnprintf(MGBA_DEBUG_STRING, 256, format, args);
+	va_end(args);
+	MGBA_DEBUG_FLAGS = MGBA_LOG_INFO | MGBA_LOG_SEND;
+}
+
+#endif
@@ -0,0 +1,186 @@
+// Eternal Horror
+// Copyright(C) 2020 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#include <gba_base.h>
+#include <gba_input.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "debug.h"
+#include "demo.h"
+
+#ifdef HOST
+uint8_t demoData[DEMO_SIZE];
+
+#define DEMO_DATA demoData
+#else
+// SRAM is on an 8-bit bus, so it is only ever accessed a byte at a time
+#define DEMO_DATA ((volatile uint8_t *) 0x0E000000)
+
+// Flash carts and emulators tell the save type from a word aligned ID string
+// in the ROM, and without one may not map SRAM at all
+const char saveType[] __attribute__((used, aligned(4))) = "SRAM_V113";
+#endif
+
+// Game state, from main.c
+extern uint32_t level;
+extern uint32_t state;
+extern int32_t health;
+
+void LoadLevel();
+
+uint16_t inputHeld = 0;
+uint16_t inputDown = 0;
+
+uint32_t demoMode = DEMO_OFF;
+uint32_t demoTick = 0;
+uint32_t demoTicks = 0;
+uint32_t demoDiverged = 0;
+
+demotick_t demoCurrent;
+
+static void DemoWrite(uint32_t offset, const void *data, uint32_t size)
+{
+	const uint8_t *p = data;
+	
+	while (size--)
+		DEMO_DATA[offset++] = *(p++);
+}
+
+static void DemoRead(uint32_t offset, void *data, uint32_t size)
+{
+	uint8_t *p = data;
+	
+	while (size--)
+		*(p++) = DEMO_DATA[offset++];
+}
+
+static uint32_t TickOffset(uint32_t tick)
+{
+	return sizeof(demoheader_t) + tick * sizeof(demotick_t);
+}
+
+void ReadInput()
+{
+	uint16_t keys;
+	
+	if (demoMode == DEMO_PLAYBACK)
+	{
+		DemoRead(TickOffset(demoTick), &demoCurrent, sizeof(demoCurrent));
+		keys = demoCurrent.keys;
+	}
+	else
+	{
+		scanKeys();
+		keys = keysHeld();
+	}
+	
+	inputDown = keys & ~inputHeld;
+	inputHeld = keys;
+}
+
+// Restarts the current level and records from its first tick. The PRNG is
+// reseeded from its own state so the seed alone reproduces it.
+void DemoStartRecording()
+{
+	uint32_t seed = randomState;
+	
+	LoadLevel();
+	SeedRandom(seed);
+	
+	demoheader_t header = { DEMO_MAGIC, seed, level, state, health, 0, inputHeld, 0 };
+	DemoWrite(0, &header, sizeof(header));
+	
+	demoMode = DEMO_RECORD;
+	demoTick = 0;
+	demoTicks = DEMO_MAX_TICKS;
+	demoDiverged = 0;
+}
+
+uint32_t DemoStartPlayback()
+{
+	demoheader_t header;
+	DemoRead(0, &header, sizeof(header));
+	
+	if (header.magic != DEMO_MAGIC || header.ticks == 0 || header.ticks > DEMO_MAX_TICKS)
+	{
+		DebugLog("demo: no recording");
+		return 0;
+	}
+	
+	level = header.level;
+	LoadLevel();
+	state = header.state;
+	health = header.health;
+	SeedRandom(header.seed);
+	inputHeld = header.keys;
+	
+	demoMode = DEMO_PLAYBACK;
+	demoTick = 0;
+	demoTicks = header.ticks;
+	demoDiverged = 0;
+	
+	DebugLog("tick,hash");
+	
+	return 1;
+}
+
+void DemoEndTick()
+{
+	if (demoMode == DEMO_OFF)
+		return;
+	
+	uint32_t hash = StateHash();
+	
+	if (demoMode == DEMO_RECORD)
+	{
+		demoCurrent.keys = inputHeld;
+		demoCurrent.hash = hash;
+		DemoWrite(TickOffset(demoTick), &demoCurrent, sizeof(demoCurrent));
+		demoTick++;
+		
+		// kept up to date so a recording cut short by power off still plays
+		DemoWrite(offsetof(demoheader_t, ticks), &demoTick, sizeof(demoTick));
+		
+		if (demoTick == demoTicks)
+		{
+			DebugLog("demo: recording full after %lu ticks", (unsigned long) demoTick);
+			DemoStop();
+		}
+	}
+	else
+	{
+		DebugLog("%lu,%08lx", (unsigned long) demoTick, (unsigned long) hash);
+		
+		if (!demoDiverged && (uint16_t) hash != demoCurrent.hash)
+		{
+			demoDiverged = demoTick + 1;
+			DebugLog("demo: diverged at tick %lu", (unsigned long) demoTick);
+		}
+		
+		demoTick++;
+		
+		if (demoTick == demoTicks)
+		{
+			if (!demoDiverged)
+				DebugLog("demo: all %lu ticks match", (unsigned long) demoTicks);
+			
+			DemoStop();
+		}
+	}
+}
+
+void DemoStop()
+{
+	demoMode = DEMO_OFF;
+}
@@ -13,6 +13,7 @@
 // MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
 // GNU General Public License for more details.
 
+#include <gba_base.h>
 #include <limits.h>
 #include <stdint.h>
 
@@ -42,7 +43,66 @@ const fixed_t tanTable[ANGLES >> 2] =
 	340373, 364404, 391956, 423871, 461291, 505787, 559593, 625996, 710035, 819849, 969498, 1185538, 1524876, 2135471, 3559833, 10680573
 };
 
-fixed_t fixedSin(angle_t a)
+const fixed_t scalarTable[MAX_HEIGHT / 2] =
+{
+#if MAX_HEIGHT > 512
+	4096, 4104, 4112, 4120, 4128, 4136, 4144, 4152, 4161, 4169, 4177, 4185, 4194, 4202, 4211, 4219,
+	4228, 4236, 4245, 4253, 4262, 4271, 4279, 4288, 4297, 4306, 4315, 4324, 4332, 4341, 4350, 4359,
+	4369, 4378, 4387, 4396, 4405, 4415, 4424, 4433, 4443, 4452, 4462, 4471, 4481, 4490, 4500, 4510,
+	4519, 4529, 4539, 4549, 4559, 4568, 4578, 4588, 4599, 4609, 4619, 4629, 4639, 4650, 4660, 4670,
+	4681, 4691, 4702, 4712, 4723, 4733, 4744, 4755, 4766, 4777, 4788, 4798, 4809, 4821, 4832, 4843,
+	4854, 4865, 4877, 4888, 4899, 4911, 4922, 4934, 4946, 4957, 4969, 4981, 4993, 5005, 5017, 5029,
+	5041, 5053, 5065, 5077, 5090, 5102, 5115, 5127, 5140, 5152, 5165, 5178, 5190, 5203, 5216, 5229,
+	5242, 5256, 5269, 5282, 5295, 5309, 5322, 5336, 5349, 5363, 5377, 5391, 5405, 5418, 5433, 5447,
+	5461, 5475, 5489, 5504, 5518, 5533, 5548, 5562, 5577, 5592, 5607, 5622, 5637, 5652, 5667, 5683,
+	5698, 5714, 5729, 5745, 5761, 5777, 5793, 5809, 5825, 5841, 5857, 5874, 5890, 5907, 5924, 5940,
+	5957, 5974, 5991, 6009, 6026, 6043, 6061, 6078, 6096, 6114, 6132, 6150, 6168, 6186, 6204, 6223,
+	6241, 6260, 6278, 6297, 6316, 6335, 6355, 6374, 6393, 6413, 6432, 6452, 6472, 6492, 6512, 6533,
+	6553, 6574, 6594, 6615, 6636, 6657, 6678, 6700, 6721, 6743, 6765, 6786, 6808, 6831, 6853, 6875,
+	6898, 6921, 6944, 6967, 6990, 7013, 7037, 7061, 7084, 7108, 7133, 7157, 7182, 7206, 7231, 7256,
+	7281, 7307, 7332, 7358, 7384, 7410, 7436, 7463, 7489, 7516, 7543, 7570, 7598, 7626, 7653, 7681,
+	7710, 7738, 7767, 7796, 7825, 7854, 7884, 7913, 7943, 7973, 8004, 8035, 8065, 8097, 8128, 8160,
+#endif
+	8192, 8224, 8256, 8289, 8322, 8355, 8388, 8422, 8456, 8490, 8525, 8559, 8594, 8630, 8665, 8701,
+	8738, 8774, 8811, 8848, 8886, 8924, 8962, 9000, 9039, 9078, 9118, 9157, 9198, 9238, 9279, 9320,
+	9362, 9404, 9446, 9489, 9532, 9576, 9619, 9664, 9709, 9754, 9799, 9845, 9892, 9939, 9986, 10034,
+	10082, 10131, 10180, 10230, 10280, 10330, 10381, 10433, 10485, 10538, 10591, 10645, 10699, 10754, 10810, 10866,
+	10922, 10979, 11037, 11096, 11155, 11214, 11275, 11335, 11397, 11459, 11522, 11586, 11650, 11715, 11781, 11848,
+	11915, 11983, 12052, 12122, 12192, 12264, 12336, 12409, 12483, 12557, 12633, 12710, 12787, 12865, 12945, 13025,
+	13107, 13189, 13273, 13357, 13443, 13530, 13617, 13706, 13797, 13888, 13981, 14074, 14169, 14266, 14364, 14463,
+	14563, 14665, 14768, 14873, 14979, 15087, 15196, 15307, 15420, 15534, 15650, 15768, 15887, 16008, 16131, 16256,
+	16384, 16513, 16644, 16777, 16912, 17050, 17189, 17331, 17476, 17623, 17772, 17924, 18078, 18236, 18396, 18558,
+	18724, 18893, 19065, 19239, 19418, 19599, 19784, 19972, 20164, 20360, 20560, 20763, 20971, 21183, 21399, 21620,
+	21845, 22075, 22310, 22550, 22795, 23045, 23301, 23563, 23831, 24105, 24385, 24672, 24966, 25266, 25575, 25890,
+	26214, 26546, 26886, 27235, 27594, 27962, 28339, 28728, 29127, 29537, 29959, 30393, 30840, 31300, 31775, 32263,
+	32768, 33288, 33825, 34379, 34952, 35544, 36157, 36792, 37449, 38130, 38836, 39568, 40329, 41120, 41943, 42799,
+	43690, 44620, 45590, 46603, 47662, 48770, 49932, 51150, 52428, 53773, 55188, 56679, 58254, 59918, 61680, 63550,
+	65536, 67650, 69905, 72315, 74898, 77672, 80659, 83886, 87381, 91180, 95325, 99864, 104857, 110376, 116508, 123361,
+	131072, 139810, 149796, 161319, 174762, 190650, 209715, 233016, 262144, 299593, 349525, 419430, 524288, 699050, 1048576, 2097152
+};
+
+const uint32_t recipTable[257] =
+{
+	65536, 65281, 65028, 64777, 64528, 64281, 64035, 63792, 63550, 63310, 63072, 62836, 62602, 62369, 62138, 61909,
+	61681, 61455, 61231, 61008, 60787, 60568, 60350, 60133, 59919, 59705, 59494, 59283, 59075, 58867, 58662, 58457,
+	58254, 58053, 57852, 57654, 57456, 57260, 57065, 56872, 56680, 56489, 56299, 56111, 55924, 55738, 55554, 55370,
+	55188, 55007, 54828, 54649, 54471, 54295, 54120, 53946, 53773, 53601, 53431, 53261, 53092, 52925, 52759, 52593,
+	52429, 52265, 52103, 51942, 51782, 51622, 51464, 51306, 51150, 50995, 50840, 50686, 50534, 50382, 50231, 50081,
+	49932, 49784, 49637, 49490, 49345, 49200, 49056, 48913, 48771, 48630, 48489, 48349, 48210, 48072, 47935, 47798,
+	47663, 47528, 47393, 47260, 47127, 46995, 46864, 46733, 46603, 46474, 46346, 46218, 46091, 45965, 45839, 45714,
+	45590, 45467, 45344, 45222, 45100, 44979, 44859, 44739, 44620, 44502, 44384, 44267, 44151, 44035, 43919, 43805,
+	43691, 43577, 43464, 43352, 43240, 43129, 43019, 42908, 42799, 42690, 42582, 42474, 42367, 42260, 42154, 42048,
+	41943, 41838, 41734, 41631, 41528, 41425, 41323, 41222, 41121, 41020, 40920, 40820, 40721, 40623, 40525, 40427,
+	40330, 40233, 40137, 40041, 39946, 39851, 39756, 39662, 39569, 39476, 39383, 39291, 39199, 39108, 39017, 38926,
+	38836, 38746, 38657, 38568, 38480, 38392, 38304, 38217, 38130, 38044, 37958, 37872, 37787, 37702, 37617, 37533,
+	37449, 37366, 37283, 37200, 37118, 37036, 36954, 36873, 36792, 36712, 36631, 36552, 36472, 36393, 36314, 36236,
+	36158, 36080, 36003, 35926, 35849, 35772, 35696, 35620, 35545, 35470, 35395, 35320, 35246, 35172, 35099, 35026,
+	34953, 34880, 34808, 34735, 34664, 34592, 34521, 34450, 34380, 34309, 34239, 34169, 34100, 34031, 33962, 33893,
+	33825, 33757, 33689, 33622, 33554, 33487, 33421, 33354, 33288, 33222, 33157, 33091, 33026, 32961, 32897, 32832,
+	32768
+};
+
+fixed_t IWRAM_CODE ARM_CODE fixedSin(angle_t a)
 {
 	const uint32_t quadrant = (((a & ANGLESMASK) & 0x180) >> 7);
 	const uint32_t index = (((a & ANGLESMASK) & 0x7F) >> 0);
@@ -56,7 +116,7 @@ fixed_t fixedSin(angle_t a)
 	}
 }
 
-fixed_t fixedCos(angle_t a)
+fixed_t IWRAM_CODE ARM_CODE fixedCos(angle_t a)
 {
 	const uint32_t quadrant = (((a & ANGLESMASK) & 0x180) >> 7);
 	const uint32_t index = (((a & ANGLESMASK) & 0x7F) >> 0);
@@ -70,7 +130,7 @@ fixed_t fixedCos(angle_t a)
 	}
 }
 
-fixed_t fixedTan(angle_t a)
+fixed_t IWRAM_CODE ARM_CODE fixedTan(angle_t a)
 {
 	const uint32_t quadrant = (((a & ANGLESMASK) & 0x180) >> 7);
 	const uint32_t index = (((a & ANGLESMASK) & 0x7F) >> 0);
@@ -82,7 +142,7 @@ fixed_t fixedTan(angle_t a)
 	}
 }
 
-fixed_t fixedCot(angle_t a)
+fixed_t IWRAM_CODE ARM_CODE fixedCot(angle_t a)
 {
 	const uint8_t quadrant = (((a & ANGLESMASK) & 0x180) >> 7);
 	const uint8_t index = (((a & ANGLESMASK) & 0x7F) >> 0);
@@ -94,8 +154,125 @@ fixed_t fixedCot(angle_t a)
 	}
 }
 
-fixed_t fixedMul(fixed_t a, fixed_t b)
+fixed_t IWRAM_CODE ARM_CODE fixedMul(fixed_t a, fixed_t b)
+{
+	return fixedMulSat(a, b);
+}
+
+// Shifts d (nonzero) left until its top bit is bit 31 and sets n to the
+// shift. The ARM7TDMI has no clz, so this takes five conditional shifts,
+// which ARM code does without branches, rather than a libgcc __clzsi2 call.
+static inline uint32_t Normalize(uint32_t d, uint32_t *n)
+{
+	*n = 0;
+	
+	if (!(d & 0xFFFF0000))
+	{
+		d <<= 16;
+		*n += 16;
+	}
+	
+	if (!(d & 0xFF000000))
+	{
+		d <<= 8;
+		*n += 8;
+	}
+	
+	if (!(d & 0xF0000000))
+	{
+		d <<= 4;
+		*n += 4;
+	}
+	
+	if (!(d & 0xC0000000))
+	{
+		d <<= 2;
+		*n += 2;
+	}
+	
+	if (!(d & 0x80000000))
+	{
+		d <<= 1;
+		*n += 1;
+	}
+	
+	return d;
+}
+
+// Reciprocal of a normalized divisor: the 9 bits under the top one (rounded)
+// index recipTable and one Newton-Raphson step brings the estimate to about
+// 18 bits. Returns r ~= 2^62 / (d << n).
+static uint32_t Reciprocal(uint32_t d, uint32_t *n)
+{
+	uint32_t nd = Normalize(d, n);
+	uint64_t r = (uint64_t) recipTable[((nd >> 22) + 1 - 512) >> 1] << 15;
+	int64_t err = ((int64_t) 1 << 62) - (int64_t) (nd * r);
+	return r + (((int64_t) r * (err >> 22)) >> 40);
+}
+
+fixed_t fixedRecip(fixed_t a)
+{
+	uint32_t u = a < 0 ? -(uint32_t) a : (uint32_t) a;
+	
+	if (u < 2)
+		return a < 0 ? INT_MIN : INT_MAX;
+	
+	uint32_t n;
+	uint64_t r = Reciprocal(u, &n);
+	uint64_t result = n >= 30 ? r << (n - 30) : r >> (30 - n);
+	
+	if (result > INT_MAX)
+		return a < 0 ? INT_MIN : INT_MAX;
+	
+	return a < 0 ? -(fixed_t) result : (fixed_t) result;
+}
+
+fixed_t fixedDiv(fixed_t a, fixed_t b)
+{
+	uint32_t ua = a < 0 ? -(uint32_t) a : (uint32_t) a;
+	uint32_t ub = b < 0 ? -(uint32_t) b : (uint32_t) b;
+	
+	if (ub == 0)
+		return (a < 0) != (b < 0) ? INT_MIN : INT_MAX;
+	
+	uint32_t n;
+	uint64_t result = ((uint64_t) ua * Reciprocal(ub, &n)) >> (46 - n);
+	
+	if (result > INT_MAX)
+		return (a < 0) != (b < 0) ? INT_MIN : INT_MAX;
+	
+	return (a < 0) != (b < 0) ? -(fixed_t) result : (fixed_t) result;
+}
+
+// Projected height in texels (2..MAX_HEIGHT, even) of a 64 unit tall wall or
+// sprite at distance d. With s = 6 + PROJECTION_SHIFT this is the smallest
+// even h with (scalarTable[(MAX_HEIGHT - h) >> 1] << s) <= d, and as that
+// entry is floor(2^22 / h) it is the smallest even h above 2^22 / ((d >> s) +
+// 1). The quotient is read from recipTable and corrected by at most one in
+// either direction, twice at VIEW_SCALE 1.
+uint32_t IWRAM_CODE ARM_CODE projectHeight(fixed_t d)
 {
-	int64_t result = ((int64_t) a * (int64_t) b) >> FRACBITS;
-	return (result < INT_MIN ? INT_MIN : result > INT_MAX ? INT_MAX : (fixed_t) result);
+	if (d < (8192 << 6))
+		return MAX_HEIGHT;
+	
+	uint32_t q = (d >> (6 + PROJECTION_SHIFT)) + 1;
+	uint32_t n;
+	uint32_t nq = Normalize(q, &n);
+	
+	uint32_t f = recipTable[((nq >> 22) + 1 - 512) >> 1] >> (25 - n);
+	
+	if ((f + 1) * q <= (1 << 22))
+		f++;
+	else if (f * q > (1 << 22))
+		f--;
+	
+#if PROJECTION_SHIFT
+	// below q = 8192 the table is read one bit less precisely
+	if ((f + 1) * q <= (1 << 22))
+		f++;
+	else if (f * q > (1 << 22))
+		f--;
+#endif
+	
+	return (f + 2) & ~1;
 }
\ No newline at end of file
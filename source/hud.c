@@ -0,0 +1,194 @@
+// Eternal Horror
+// Copyright(C) 2020 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#include <gba_base.h>
+#include <gba_sprites.h>
+#include <gba_video.h>
+#include <stdint.h>
+
+#include "blit.h"
+#include "graphics.h"
+#include "hud.h"
+#include "kernels.h"
+#include "sprites.h"
+
+// 256 colour tiles from the start of the bitmap modes' OBJ VRAM: a 64x64
+// OBJ for each hand frame, each hand texel HUD_HAND_PIXELS screen pixels
+// wide and tall, then the bar tiles, tile k filling VIEW_SCALE (k + 1)
+// columns of its top 2 VIEW_SCALE rows. A 256 colour tile is two character
+// names.
+#define HUD_HAND_PIXELS (VIEW_SCALE * HUD_HAND_SCALE)
+#define HUD_HAND_TILE 0
+#define HUD_BAR_TILE 128
+#define HUD_CHAR(tile) (512 + (tile) * 2)
+
+// Screen position of a view texel, see view.h
+#define HUD_X(x) (VIEW_SCREEN_X + (x) * VIEW_SCALE)
+#define HUD_Y(y) (VIEW_SCREEN_Y + (y) * VIEW_SCALE)
+
+#define HUD_BAR_COLOR 0x2A
+
+OBJATTR hudObjs[HUD_OBJS];
+uint32_t hudVisible = 0;
+uint32_t hudHandFrame = 0;
+uint32_t hudBarWidth = 0;
+uint32_t hudDirty = 0;
+
+#if TRIPLE_BUFFER
+OBJATTR hudQueued[HUD_OBJS];
+uint32_t hudQueuedDirty = 0;
+#endif
+
+static uint8_t HudColor(uint8_t color)
+{
+	if (color == SPRITE_COLOR_KEY)
+		return 0;
+	
+	return color == 0 ? SPRITE_COLOR_KEY : color;
+}
+
+void HudInit()
+{
+	static uint8_t tiles[64 * 64] EWRAM_BSS;
+	uint16_t *objVram = BITMAP_OBJ_BASE_ADR;
+	
+	for (uint32_t frame = 0; frame < 2; frame++)
+	{
+		const uint8_t *hand = &graphicsBitmap[HUD_HAND + frame * HUD_HAND_WIDTH];
+		
+		for (uint32_t y = 0; y < 64; y++)
+		{
+			for (uint32_t x = 0; x < 64; x++)
+			{
+				uint8_t color = 0;
+				
+				if (x < HUD_HAND_WIDTH * HUD_HAND_PIXELS && y < HUD_HAND_HEIGHT * HUD_HAND_PIXELS)
+					color = HudColor(hand[(y / HUD_HAND_PIXELS) * 64 + x / HUD_HAND_PIXELS]);
+				
+				tiles[((y >> 3) * 8 + (x >> 3)) * 64 + (y & 7) * 8 + (x & 7)] = color;
+			}
+		}
+		
+		BlitCopy(&objVram[(HUD_HAND_TILE + frame * 64) * 32], tiles, 64 * 32);
+	}
+	
+	for (uint32_t k = 0; k < 4; k++)
+	{
+		for (uint32_t i = 0; i < 64; i++)
+			tiles[k * 64 + i] = (i >> 3) < 2 * VIEW_SCALE && (i & 7) < VIEW_SCALE * (k + 1) ? HUD_BAR_COLOR : 0;
+	}
+	
+	BlitCopy(&objVram[HUD_BAR_TILE * 32], tiles, 4 * 32);
+	
+	BlitCopy(OBJ_COLORS, graphicsPal, 256);
+	OBJ_COLORS[SPRITE_COLOR_KEY] = graphicsPal[0];
+	
+	for (uint32_t i = 0; i < 128; i++)
+		OAM[i].attr0 = ATTR0_DISABLED;
+	
+	for (uint32_t i = 0; i < HUD_OBJS; i++)
+		hudObjs[i].attr0 = ATTR0_DISABLED;
+	
+	hudVisible = 0;
+	hudDirty = 0;
+}
+
+void HudUpdate(uint32_t visible, uint32_t handFrame, uint32_t barWidth)
+{
+	if (!visible)
+		handFrame = barWidth = 0;
+	
+	if (visible == hudVisible && handFrame == hudHandFrame && barWidth == hudBarWidth)
+		return;
+	
+	hudVisible = visible;
+	hudHandFrame = handFrame;
+	hudBarWidth = barWidth;
+	hudDirty = 1;
+	
+	OBJATTR *obj = &hudObjs[0];
+	
+	if (visible)
+	{
+		obj->attr0 = OBJ_Y(HUD_Y(HUD_HAND_Y)) | ATTR0_COLOR_256 | ATTR0_SQUARE;
+		obj->attr1 = OBJ_X(HUD_X(HUD_HAND_X)) | ATTR1_SIZE_64;
+		obj->attr2 = OBJ_CHAR(HUD_CHAR(HUD_HAND_TILE + handFrame * 64));
+	}
+	else
+		obj->attr0 = ATTR0_DISABLED;
+	
+	// a bar tile for every 4 texels of the bar, the last one covering
+	// what is left
+	for (uint32_t i = 0; i < HUD_BAR_OBJS; i++)
+	{
+		obj = &hudObjs[1 + i];
+		
+		if (i * 4 >= barWidth)
+		{
+			obj->attr0 = ATTR0_DISABLED;
+			continue;
+		}
+		
+		uint32_t width = barWidth - i * 4;
+		
+		obj->attr0 = OBJ_Y(HUD_Y(HUD_BAR_Y)) | ATTR0_COLOR_256 | ATTR0_SQUARE;
+		obj->attr1 = OBJ_X(HUD_X(HUD_BAR_X + i * 4)) | ATTR1_SIZE_8;
+		obj->attr2 = OBJ_CHAR(HUD_CHAR(HUD_BAR_TILE + (width < 4 ? width : 4) - 1));
+	}
+}
+
+void HudCommit()
+{
+	if (!hudDirty)
+		return;
+	
+	for (uint32_t i = 0; i < HUD_OBJS; i++)
+	{
+		OAM[i].attr0 = hudObjs[i].attr0;
+		OAM[i].attr1 = hudObjs[i].attr1;
+		OAM[i].attr2 = hudObjs[i].attr2;
+	}
+	
+	hudDirty = 0;
+}
+
+#if TRIPLE_BUFFER
+// Called with interrupts off, as the frame's page is queued
+void HudQueue()
+{
+	if (!hudDirty)
+		return;
+	
+	for (uint32_t i = 0; i < HUD_OBJS; i++)
+		hudQueued[i] = hudObjs[i];
+	
+	hudQueuedDirty = 1;
+	hudDirty = 0;
+}
+
+// Called from the VBlank interrupt that shows the queued page
+void HudCommitQueued()
+{
+	if (!hudQueuedDirty)
+		return;
+	
+	for (uint32_t i = 0; i < HUD_OBJS; i++)
+	{
+		OAM[i].attr0 = hudQueued[i].attr0;
+		OAM[i].attr1 = hudQueued[i].attr1;
+		OAM[i].attr2 = hudQueued[i].attr2;
+	}
+	
+	hudQueuedDirty = 0;
+}
+#endif
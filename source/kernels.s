@@ -0,0 +1,292 @@
+@ Eternal Horror
+@ Copyright(C) 2020 John D. Corrado
+@
+@ This program is free software; you can redistribute it and/or
+@ modify it under the terms of the GNU General Public License
+@ as published by the Free Software Foundation; either version 2
+@ of the License, or (at your option) any later version.
+@
+@ This program is distributed in the hope that it will be useful,
+@ but WITHOUT ANY WARRANTY; without even the implied warranty of
+@ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+@ GNU General Public License for more details.
+
+@ ARM versions of the column and span kernels in main.c, see kernels.h. They
+@ write exactly what DrawWallColumnC and DrawPlaneSpanC write, in the mode 4
+@ or the mode 5 layout picked by COMPACT_FRAMEBUFFER, and with LIGHTING look
+@ every texel up in lightTable.
+
+#include "kernels.h"
+
+	.section .iwram, "ax", %progbits
+	.arm
+	.align 2
+
+@ Turns the palette index in reg into the halfword to store: the colour at
+@ table in mode 5, where table is colorTable or the light table, and in mode
+@ 4 the index in both bytes, looked up in the light table at table first
+@ with LIGHTING.
+
+	.macro LIGHT_PIXEL reg, table
+#if COMPACT_FRAMEBUFFER
+	add	\reg, \table, \reg, lsl #1
+	ldrh	\reg, [\reg]
+#else
+#if LIGHTING
+	ldrb	\reg, [\table, \reg]
+#endif
+	orr	\reg, \reg, \reg, lsl #8
+#endif
+	.endm
+
+@ void DrawWallColumnArm(uint16_t *p, const uint8_t *texture,
+@                        fixed_t textureOffsetY, fixed_t scalar, uint32_t count)
+@
+@ r0 = p, r1 = texture, r2 = textureOffsetY, r3 = scalar, r12 = texels left.
+@ The odd texels are drawn first so the main loop can draw four at a time.
+@ Mode 5 looks the texels up in colorTable (r8) and stores one halfword per
+@ row, r9 = row bytes. With LIGHTING r8 is lightTable in both modes, which
+@ costs mode 4 one ldrb a texel.
+
+	.global DrawWallColumnArm
+	.type DrawWallColumnArm, %function
+DrawWallColumnArm:
+#if COMPACT_FRAMEBUFFER
+	ldr	r12, [sp]
+	push	{r4-r9}
+#if LIGHTING
+	ldr	r8, =lightTable
+	ldr	r8, [r8]
+#else
+	ldr	r8, =colorTable
+#endif
+	mov	r9, #ROW_STRIDE * 2
+	add	r12, r12, #1
+	ands	r4, r12, #3
+	beq	2f
+1:
+	ldrb	r5, [r1, r2, lsr #16]
+	add	r2, r2, r3
+	add	r5, r8, r5, lsl #1
+	ldrh	r5, [r5]
+	strh	r5, [r0], r9
+	subs	r4, r4, #1
+	bne	1b
+2:
+	movs	r12, r12, lsr #2
+	beq	4f
+3:
+	ldrb	r4, [r1, r2, lsr #16]
+	add	r2, r2, r3
+	ldrb	r5, [r1, r2, lsr #16]
+	add	r2, r2, r3
+	ldrb	r6, [r1, r2, lsr #16]
+	add	r2, r2, r3
+	ldrb	r7, [r1, r2, lsr #16]
+	add	r2, r2, r3
+	add	r4, r8, r4, lsl #1
+	ldrh	r4, [r4]
+	strh	r4, [r0], r9
+	add	r5, r8, r5, lsl #1
+	ldrh	r5, [r5]
+	strh	r5, [r0], r9
+	add	r6, r8, r6, lsl #1
+	ldrh	r6, [r6]
+	strh	r6, [r0], r9
+	add	r7, r8, r7, lsl #1
+	ldrh	r7, [r7]
+	strh	r7, [r0], r9
+	subs	r12, r12, #1
+	bne	3b
+4:
+	pop	{r4-r9}
+	bx	lr
+	.ltorg
+#else
+	ldr	r12, [sp]
+#if LIGHTING
+	push	{r4-r8}
+	ldr	r8, =lightTable
+	ldr	r8, [r8]
+#else
+	push	{r4-r7}
+#endif
+	add	r12, r12, #1
+	ands	r4, r12, #3
+	beq	2f
+1:
+	ldrb	r5, [r1, r2, lsr #16]
+	add	r2, r2, r3
+	LIGHT_PIXEL r5, r8
+	strh	r5, [r0], #240
+	strh	r5, [r0], #240
+	subs	r4, r4, #1
+	bne	1b
+2:
+	movs	r12, r12, lsr #2
+	beq	4f
+3:
+	ldrb	r4, [r1, r2, lsr #16]
+	add	r2, r2, r3
+	ldrb	r5, [r1, r2, lsr #16]
+	add	r2, r2, r3
+	ldrb	r6, [r1, r2, lsr #16]
+	add	r2, r2, r3
+	ldrb	r7, [r1, r2, lsr #16]
+	add	r2, r2, r3
+	LIGHT_PIXEL r4, r8
+	strh	r4, [r0], #240
+	strh	r4, [r0], #240
+	LIGHT_PIXEL r5, r8
+	strh	r5, [r0], #240
+	strh	r5, [r0], #240
+	LIGHT_PIXEL r6, r8
+	strh	r6, [r0], #240
+	strh	r6, [r0], #240
+	LIGHT_PIXEL r7, r8
+	strh	r7, [r0], #240
+	strh	r7, [r0], #240
+	subs	r12, r12, #1
+	bne	3b
+4:
+#if LIGHTING
+	pop	{r4-r8}
+	bx	lr
+	.ltorg
+#else
+	pop	{r4-r7}
+	bx	lr
+#endif
+#endif
+	.size DrawWallColumnArm, . - DrawWallColumnArm
+
+@ void DrawPlaneSpanArm(uint16_t *p1, uint16_t *p2,
+@                       const planetexel_t *texture, fixed_t x, fixed_t y,
+@                       fixed_t stepX, fixed_t stepY, uint32_t count)
+@
+@ r0 = p1, r1 = p2, r2 = texture, r3 = x, r4 = y, r5 = stepX, r6 = stepY,
+@ r7 = pixels left, r8 = 126. The texel byte offset is taken straight from
+@ x >> 15 and y >> 15 masked with 126, one ldrh fetches floor and ceiling. An
+@ odd pixel is drawn first so the main loop can draw two at a time, with both
+@ texture offsets computed before the loads.
+@
+@ Mode 5 texels are words holding both colours, so the mask is 252 and the
+@ floor and ceiling are the low and high halfwords of one ldr. With LIGHTING
+@ texels are palette indices in both modes, drawn as in mode 4 but looked
+@ up in lightTable (r12), and mode 5 stores one halfword per pixel.
+
+	.macro PUT_PLANE_PIXELS floor, ceiling
+#if COMPACT_FRAMEBUFFER
+	strh	\floor, [r0], #2
+	strh	\ceiling, [r1], #2
+#else
+	strh	\floor, [r0, #240]
+	strh	\floor, [r0], #2
+	strh	\ceiling, [r1, #240]
+	strh	\ceiling, [r1], #2
+#endif
+	.endm
+
+	.global DrawPlaneSpanArm
+	.type DrawPlaneSpanArm, %function
+DrawPlaneSpanArm:
+	push	{r4-r11}
+	add	r12, sp, #32
+	ldmia	r12, {r4-r7}
+#if COMPACT_FRAMEBUFFER && !LIGHTING
+	mov	r8, #252
+	add	r7, r7, #1
+	tst	r7, #1
+	beq	1f
+	and	r9, r8, r3, lsr #14
+	and	r10, r8, r4, lsr #14
+	add	r3, r3, r5
+	add	r4, r4, r6
+	add	r9, r9, r10, lsl #6
+	ldr	r9, [r2, r9]
+	strh	r9, [r0], #2
+	mov	r9, r9, lsr #16
+	strh	r9, [r1], #2
+1:
+	movs	r7, r7, lsr #1
+	beq	3f
+2:
+	and	r9, r8, r3, lsr #14
+	and	r10, r8, r4, lsr #14
+	add	r3, r3, r5
+	add	r4, r4, r6
+	add	r9, r9, r10, lsl #6
+	and	r11, r8, r3, lsr #14
+	and	r10, r8, r4, lsr #14
+	add	r3, r3, r5
+	add	r4, r4, r6
+	add	r11, r11, r10, lsl #6
+	ldr	r9, [r2, r9]
+	ldr	r11, [r2, r11]
+	strh	r9, [r0], #2
+	mov	r9, r9, lsr #16
+	strh	r9, [r1], #2
+	strh	r11, [r0], #2
+	mov	r11, r11, lsr #16
+	strh	r11, [r1], #2
+	subs	r7, r7, #1
+	bne	2b
+3:
+	pop	{r4-r11}
+	bx	lr
+#else
+#if LIGHTING
+	ldr	r12, =lightTable
+	ldr	r12, [r12]
+#endif
+	mov	r8, #126
+	add	r7, r7, #1
+	tst	r7, #1
+	beq	1f
+	and	r9, r8, r3, lsr #15
+	and	r10, r8, r4, lsr #15
+	add	r3, r3, r5
+	add	r4, r4, r6
+	add	r9, r9, r10, lsl #6
+	ldrh	r9, [r2, r9]
+	and	r10, r9, #0xFF
+	mov	r9, r9, lsr #8
+	LIGHT_PIXEL r10, r12
+	LIGHT_PIXEL r9, r12
+	PUT_PLANE_PIXELS r10, r9
+1:
+	movs	r7, r7, lsr #1
+	beq	3f
+2:
+	and	r9, r8, r3, lsr #15
+	and	r10, r8, r4, lsr #15
+	add	r3, r3, r5
+	add	r4, r4, r6
+	add	r9, r9, r10, lsl #6
+	and	r11, r8, r3, lsr #15
+	and	r10, r8, r4, lsr #15
+	add	r3, r3, r5
+	add	r4, r4, r6
+	add	r11, r11, r10, lsl #6
+	ldrh	r9, [r2, r9]
+	ldrh	r11, [r2, r11]
+	and	r10, r9, #0xFF
+	mov	r9, r9, lsr #8
+	LIGHT_PIXEL r10, r12
+	LIGHT_PIXEL r9, r12
+	PUT_PLANE_PIXELS r10, r9
+	and	r10, r11, #0xFF
+	mov	r11, r11, lsr #8
+	LIGHT_PIXEL r10, r12
+	LIGHT_PIXEL r11, r12
+	PUT_PLANE_PIXELS r10, r11
+	subs	r7, r7, #1
+	bne	2b
+3:
+	pop	{r4-r11}
+	bx	lr
+#if LIGHTING
+	.ltorg
+#endif
+#endif
+	.size DrawPlaneSpanArm, . - DrawPlaneSpanArm
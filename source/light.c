@@ -0,0 +1,82 @@
+// Eternal Horror
+// Copyright(C) 2020 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#include <gba_base.h>
+#include <gba_video.h>
+#include <stdint.h>
+
+#include "graphics.h"
+#include "kernels.h"
+#include "light.h"
+
+#if LIGHTING
+lighttable_t lightTables[LIGHT_LEVELS + 1][256];
+const lighttable_t *lightTable = lightTables[0];
+
+// The 5-bit red, green and blue of a palette colour
+#define RED(color) ((color) & 31)
+#define GREEN(color) (((color) >> 5) & 31)
+#define BLUE(color) (((color) >> 10) & 31)
+
+#if !COMPACT_FRAMEBUFFER
+// The palette index whose colour is nearest to color
+static uint32_t IWRAM_CODE ARM_CODE NearestColor(uint32_t color)
+{
+	int32_t r = RED(color);
+	int32_t g = GREEN(color);
+	int32_t b = BLUE(color);
+	uint32_t best = 0;
+	int32_t bestError = INT32_MAX;
+	
+	for (uint32_t i = 0; i < 256 && bestError; i++)
+	{
+		int32_t dr = RED(graphicsPal[i]) - r;
+		int32_t dg = GREEN(graphicsPal[i]) - g;
+		int32_t db = BLUE(graphicsPal[i]) - b;
+		int32_t error = dr * dr + dg * dg + db * db;
+		
+		if (error < bestError)
+		{
+			best = i;
+			bestError = error;
+		}
+	}
+	
+	return best;
+}
+#endif
+
+void LightInit()
+{
+	uint32_t fog = graphicsPal[FOG_COLOR];
+	
+	for (uint32_t level = 0; level <= LIGHT_LEVELS; level++)
+	{
+		uint32_t bright = LIGHT_LEVELS - level;
+		
+		for (uint32_t i = 0; i < 256; i++)
+		{
+			uint32_t color = graphicsPal[i];
+			uint32_t r = (RED(color) * bright + RED(fog) * level + LIGHT_LEVELS / 2) / LIGHT_LEVELS;
+			uint32_t g = (GREEN(color) * bright + GREEN(fog) * level + LIGHT_LEVELS / 2) / LIGHT_LEVELS;
+			uint32_t b = (BLUE(color) * bright + BLUE(fog) * level + LIGHT_LEVELS / 2) / LIGHT_LEVELS;
+#if COMPACT_FRAMEBUFFER
+			lightTables[level][i] = RGB5(r, g, b);
+#else
+			// level 0 is the palette itself, whatever its duplicates
+			lightTables[level][i] = level ? NearestColor(RGB5(r, g, b)) : i;
+#endif
+		}
+	}
+}
+#endif
@@ -23,10 +23,88 @@
 #include <string.h>
 #include <time.h>
 
+#include "blit.h"
+#include "debug.h"
+#include "demo.h"
 #include "fixed.h"
 #include "graphics.h"
+#include "hud.h"
+#include "kernels.h"
 #include "levels.h"
+#include "light.h"
+#include "profile.h"
+#include "scalers.h"
+#include "sprites.h"
+#include "timedemo.h"
 
+// Ray core: 1 steps one interleaved DDA through both gridline walks and stops
+// at the first hit, 0 runs the horizontal and vertical walks separately
+#ifndef DDA_RAYCASTER
+#define DDA_RAYCASTER 1
+#endif
+
+// How far (in map units) past the first hit the DDA keeps checking the other
+// walk, covering the quarter units it orders the crossings in and the
+// rounding of the view distances the nearer hit is picked by
+#define DDA_HIT_MARGIN 8
+
+// Column ray angles: 0 spaces the columns one angle apart (two to an angle at
+// VIEW_SCALE 1), 1 spaces them evenly on the projection plane sprites and
+// planes are drawn on (rounded to the nearest angle, so some columns towards
+// the edges, where they are less than an angle apart, share a ray)
+#ifndef CORRECTED_COLUMNS
+#define CORRECTED_COLUMNS 0
+#endif
+
+// Ray cache: 1 keeps the hit of every ray angle while the camera stays put,
+// so turning only traces the angles that came into view, see UpdateRayCache
+#ifndef RAY_CACHE
+#define RAY_CACHE 1
+#endif
+
+// The door and sprite cells one cached ray can have passed
+#define RAY_CACHE_CELLS 4
+
+// The doors, enemies and health pickups a level can hold of each, see
+// LoadEntities. entityIndex is a byte per cell, so at most 255.
+#define MAX_ENTITIES 255
+#define NO_ENTITY 255
+
+// The sprites drawn in a frame, the nearest ones when more are in view
+#ifndef MAX_VISSPRITES
+#define MAX_VISSPRITES 64
+#endif
+
+// Dynamic resolution: 1 times every frame and renders two thirds or half of
+// the view's columns, each drawn 1 or 2 view columns wide, while frames cost
+// nearly a whole frame time, see ResolutionUpdate. 0 always renders them all.
+#ifndef DYNAMIC_RESOLUTION
+#define DYNAMIC_RESOLUTION 0
+#endif
+
+// 1 sends every change of resolution to the debug log
+#ifndef RESOLUTION_LOG
+#define RESOLUTION_LOG 0
+#endif
+
+// Interlaced columns: 1 traces and draws every other rendered column a frame,
+// the even ones on one and the odd ones on the next, and copies the rest from
+// the page shown, shifted by how far the camera turned, see CopyColumns.
+// interlaceColumns turns it on and off at run time.
+#ifndef INTERLACED_COLUMNS
+#define INTERLACED_COLUMNS 0
+#endif
+
+// Cycles in one frame time, 228 lines of 1232, from one VBlank to the next.
+// A frame over RESOLUTION_DROP of them drops a step at once, and
+// RESOLUTION_HOLD frames in a row under RESOLUTION_RESTORE go back up one,
+// far enough apart that the two do not take turns.
+#define RESOLUTION_BUDGET 280896
+#define RESOLUTION_DROP (RESOLUTION_BUDGET / 16 * 15)
+#define RESOLUTION_RESTORE (RESOLUTION_BUDGET / 8 * 5)
+#define RESOLUTION_HOLD 30
+
+// state: 0 opening soon, 1 opening, 2 open, 3 closing, 4 closed
 typedef struct
 {
 	int32_t mapIndex;
@@ -57,60 +135,77 @@ typedef struct
 	uint32_t render;
 } health_t;
 
+typedef struct
+{
+	fixed_t cot;
+	fixed_t tan;
+	fixed_t horizontalEdgeY;
+	fixed_t horizontalStepX;
+	fixed_t horizontalStepY;
+	fixed_t verticalEdgeX;
+	fixed_t verticalStepX;
+	fixed_t verticalStepY;
+	int32_t absSin;
+	int32_t absCos;
+	int32_t hitMargin;
+#if LIGHTING
+	int32_t fogLength;
+	fixed_t fogReachX;
+	fixed_t fogReachY;
+#endif
+} ray_t;
+
+// A traced ray: the point it hit, the offset of the wall texture in
+// graphicsBitmap and its column there, and with RAY_CACHE the door and
+// sprite cells it passed on the way. hitX is INT_MAX if it hit nothing.
+typedef struct
+{
+	fixed_t hitX;
+	fixed_t hitY;
+	uint32_t generation;
+	uint16_t texture;
+	uint8_t textureOffsetX;
+	uint8_t numDoors;
+	uint8_t numSprites;
+	uint16_t doorCells[RAY_CACHE_CELLS];
+	uint16_t spriteCells[RAY_CACHE_CELLS];
+} rayhit_t;
+
+// A sprite left to draw this frame, see CollectSprites
+typedef struct
+{
+	fixed_t distance;
+	uint32_t spriteFrame;
+	int16_t spriteX;
+	uint16_t spriteSize;
+	uint32_t damage;
+} vissprite_t;
+
 typedef struct
 {
 	int32_t minX;
 	int32_t maxX;
 	uint32_t pad1;
-	uint32_t top[120];
+	uint32_t top[VIEW_WIDTH];
 	uint32_t pad2;
 } plane_t;
 
-const fixed_t scalarTable[256] =
-{
-	8192, 8224, 8256, 8289, 8322, 8355, 8388, 8422, 8456, 8490, 8525, 8559, 8594, 8630, 8665, 8701,
-	8738, 8774, 8811, 8848, 8886, 8924, 8962, 9000, 9039, 9078, 9118, 9157, 9198, 9238, 9279, 9320,
-	9362, 9404, 9446, 9489, 9532, 9576, 9619, 9664, 9709, 9754, 9799, 9845, 9892, 9939, 9986, 10034,
-	10082, 10131, 10180, 10230, 10280, 10330, 10381, 10433, 10485, 10538, 10591, 10645, 10699, 10754, 10810, 10866,
-	10922, 10979, 11037, 11096, 11155, 11214, 11275, 11335, 11397, 11459, 11522, 11586, 11650, 11715, 11781, 11848,
-	11915, 11983, 12052, 12122, 12192, 12264, 12336, 12409, 12483, 12557, 12633, 12710, 12787, 12865, 12945, 13025,
-	13107, 13189, 13273, 13357, 13443, 13530, 13617, 13706, 13797, 13888, 13981, 14074, 14169, 14266, 14364, 14463,
-	14563, 14665, 14768, 14873, 14979, 15087, 15196, 15307, 15420, 15534, 15650, 15768, 15887, 16008, 16131, 16256,
-	16384, 16513, 16644, 16777, 16912, 17050, 17189, 17331, 17476, 17623, 17772, 17924, 18078, 18236, 18396, 18558,
-	18724, 18893, 19065, 19239, 19418, 19599, 19784, 19972, 20164, 20360, 20560, 20763, 20971, 21183, 21399, 21620,
-	21845, 22075, 22310, 22550, 22795, 23045, 23301, 23563, 23831, 24105, 24385, 24672, 24966, 25266, 25575, 25890,
-	26214, 26546, 26886, 27235, 27594, 27962, 28339, 28728, 29127, 29537, 29959, 30393, 30840, 31300, 31775, 32263,
-	32768, 33288, 33825, 34379, 34952, 35544, 36157, 36792, 37449, 38130, 38836, 39568, 40329, 41120, 41943, 42799,
-	43690, 44620, 45590, 46603, 47662, 48770, 49932, 51150, 52428, 53773, 55188, 56679, 58254, 59918, 61680, 63550,
-	65536, 67650, 69905, 72315, 74898, 77672, 80659, 83886, 87381, 91180, 95325, 99864, 104857, 110376, 116508, 123361,
-	131072, 139810, 149796, 161319, 174762, 190650, 209715, 233016, 262144, 299593, 349525, 419430, 524288, 699050, 1048576, 2097152
-};
-
-const fixed_t planeDistanceTable[32] =
-{
-	268435456, 89478485, 53687091, 38347922, 29826161, 24403223, 20648881, 17895697, 15790320, 14128181, 12782640, 11671106, 10737418, 9942053, 9256395, 8659208,
-	8134407, 7669584, 7255012, 6882960, 6547206, 6242685, 5965232, 5711392, 5478274, 5263440, 5064819, 4880644, 4709393, 4549753, 4400581, 4260880
-};
-
-const int32_t healthBarTable[100] =
-{
-	0, 0, 1, 1, 2, 3, 3, 4, 5, 5,
-	6, 7, 7, 8, 8, 9, 10, 10, 11, 12,
-	12, 13, 14, 14, 15, 16, 16, 17, 17, 18,
-	19, 19, 20, 21, 21, 22, 23, 23, 24, 24,
-	25, 26, 26, 27, 28, 28, 29, 30, 30, 31,
-	32, 32, 33, 33, 34, 35, 35, 36, 37, 37,
-	38, 39, 39, 40, 40, 41, 42, 42, 43, 44,
-	44, 45, 46, 46, 47, 48, 48, 49, 49, 50,
-	51, 51, 52, 53, 53, 54, 55, 55, 56, 56,
-	57, 58, 58, 59, 60, 60, 61, 62, 62, 63
-};
+// The distance of every plane row from the horizon down and with LIGHTING its
+// light table, and the health bar width for every health, see InitViewTables
+fixed_t planeDistanceTable[VIEW_HEIGHT / 2];
+#if LIGHTING
+const lighttable_t *rowLightTables[VIEW_HEIGHT / 2];
+#endif
+int32_t healthBarTable[100];
 
 const uint32_t mapWidth = 64;
 const uint32_t mapHeight = 64;
 
 uint32_t mapData[4096];
 
+// Bumped on every change to mapData, see UpdateRayCache
+uint32_t mapVersion = 0;
+
 uint32_t level = 1;
 const uint32_t numLevels = 4;
 const uint32_t *levels[] =
@@ -133,103 +228,251 @@ uint32_t attackTics = 0;
 uint32_t fireWeaponPressed;
 uint32_t restartLevelPressed;
 
-door_t doors[64] =
-{
-	{ -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 },
-	{ -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 },
-	{ -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 },
-	{ -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 },
-	{ -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 },
-	{ -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 },
-	{ -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 },
-	{ -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }, { -1, 0, 64 << FRACBITS, 0 }
-};
-
-enemy_t enemies[64] =
-{
-	{ -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
-	{ -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
-	{ -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
-	{ -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
-	{ -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
-	{ -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
-	{ -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
-	{ -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }
-};
-
-health_t healths[64] =
-{
-	{ 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 },
-	{ 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 },
-	{ 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 },
-	{ 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 },
-	{ 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 },
-	{ 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 },
-	{ 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 },
-	{ 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }
-};
+// The entities of the level, packed at the front of each table. A door,
+// enemy or health cell's entry is at entityIndex[mapIndex] in the table of
+// its type.
+door_t doors[MAX_ENTITIES] EWRAM_BSS;
+enemy_t enemies[MAX_ENTITIES] EWRAM_BSS;
+health_t healths[MAX_ENTITIES] EWRAM_BSS;
+uint32_t doorCount = 0;
+uint32_t enemyCount = 0;
+uint32_t healthCount = 0;
+uint8_t entityIndex[4096] EWRAM_BSS;
 
-uint16_t *yTable[2][64];
-uint16_t xTable[120];
+uint16_t *yTable[PAGES][VIEW_HEIGHT];
+uint16_t xTable[VIEW_WIDTH];
 uint32_t page = 1;
+volatile uint32_t shownPage = 0;
 
 plane_t plane;
 
-uint32_t start[32];
-uint32_t stop[32];
-fixed_t currentX[32];
-fixed_t currentY[32];
-fixed_t stepX[32];
-fixed_t stepY[32];
+// Plane rows: the column each open span starts at, and the world position
+// of column 0 and the step per column, built once per frame
+uint32_t start[VIEW_HEIGHT / 2];
+fixed_t rowX[VIEW_HEIGHT / 2];
+fixed_t rowY[VIEW_HEIGHT / 2];
+fixed_t stepX[VIEW_HEIGHT / 2];
+fixed_t stepY[VIEW_HEIGHT / 2];
 fixed_t fovInvCos = 92119;
-fixed_t invViewWidth = 512;
+fixed_t invViewWidth = 512 >> PROJECTION_SHIFT;
+
+fixed_t zBuffer[VIEW_WIDTH];
+
+// The farthest wall in each run of 8 columns, for rejecting hidden sprites
+fixed_t zBufferMax[VIEW_WIDTH / 8];
+
+// The enemy and health cells the rays passed this frame, each once
+uint16_t spriteCandidates[MAX_ENTITIES * 2];
+uint32_t spriteCandidateCount = 0;
+
+// Sorted far to near, at most MAX_VISSPRITES of the nearest
+vissprite_t vissprites[MAX_VISSPRITES];
+uint32_t visspriteCount;
 
-fixed_t zBuffer[120];
+ray_t rayTable[ANGLES] EWRAM_BSS;
+
+#if RAY_CACHE
+// The last hit of every ray angle. An entry is valid while its generation is
+// rayGeneration, which moves on whenever the camera moves or the map changes.
+rayhit_t rayCache[ANGLES] EWRAM_BSS;
+uint32_t rayGeneration = 1;
+fixed_t rayCacheX;
+fixed_t rayCacheY;
+uint32_t rayCacheMapVersion;
+fixed_t rayCacheDoorOffsets[MAX_ENTITIES] EWRAM_BSS;
+#endif
+
+// The floor and ceiling textures interleaved, see PLANE_TEXEL
+planetexel_t planeTexture[4096] EWRAM_BSS;
+
+#if COMPACT_FRAMEBUFFER
+uint16_t colorTable[256];
+#endif
+int32_t columnAngleTable[VIEW_WIDTH];
 
-uint32_t frames[6] = { 24576, 28672, 32768, 36864, 40960, 45056 };
 uint32_t frame = 0;
 uint32_t frameTics = 0;
 
-uint32_t bloodHeight[120];
-uint32_t bloodSpeed[120];
+uint32_t bloodHeight[VIEW_WIDTH];
+uint32_t bloodSpeed[VIEW_WIDTH];
 uint32_t bloodTics = 0;
 
 uint32_t solidPlanes = 0;
 
-uint32_t IWRAM_CODE FindHeight(fixed_t d)
+// The rendered columns, full resolution first. columnWidth[i] is how many
+// view columns the rendered column starting at view column i covers.
+const uint32_t resolutionSteps[3] = { VIEW_WIDTH, VIEW_WIDTH - VIEW_WIDTH / 3, VIEW_WIDTH / 2 };
+uint8_t columnWidth[VIEW_WIDTH];
+uint32_t resolutionStep = 0;
+uint32_t resolutionCalm = 0;
+
+// Counters: the columns rendered now and the times they were reduced
+uint32_t renderColumns = VIEW_WIDTH;
+uint32_t resolutionDrops = 0;
+
+// Interlacing: whether the last frame's page can be copied from, and the
+// camera position and angle, map version and traced column parity it was
+// drawn with, and without RAY_CACHE whether a door was moving. Per view
+// column, the ray the last frame traced it with and its depth then, and the
+// ray this frame traced it with. NO_RAY marks a column that was copied or
+// that a sprite was drawn over, which cannot be copied from.
+#define NO_RAY 0xFFFF
+
+uint32_t interlaceColumns = INTERLACED_COLUMNS;
+uint32_t interlaceValid = 0;
+uint32_t interlacePage;
+angle_t interlaceAngle;
+fixed_t interlaceX;
+fixed_t interlaceY;
+#if !RAY_CACHE
+uint32_t interlaceDoorsMoving = 0;
+#endif
+uint32_t interlaceMapVersion;
+uint32_t interlaceParity = 0;
+uint16_t interlaceRay[VIEW_WIDTH];
+fixed_t interlaceDepth[VIEW_WIDTH];
+uint16_t columnRay[VIEW_WIDTH];
+
+// Counter: the view columns copied instead of traced
+uint32_t interlaceCopies = 0;
+
+// Game state PRNG, a 32-bit xorshift so that a recording replays the same
+// enemy pairings and blood wipe from the seed it started with, see demo.h
+uint32_t randomState = 1;
+
+uint32_t Random()
+{
+	randomState ^= randomState << 13;
+	randomState ^= randomState >> 17;
+	randomState ^= randomState << 5;
+	return randomState;
+}
+
+void SeedRandom(uint32_t seed)
 {
-	int32_t l = 0;
-	int32_t r = 255;
+	randomState = seed ? seed : 1;
 	
-	while (l <= r)
+	for (uint32_t i = 0; i < VIEW_WIDTH; i++)
+		bloodSpeed[i] = Random() % 4 + 2;
+}
+
+#if !ASM_KERNELS || KERNEL_BENCH
+void IWRAM_CODE ARM_CODE DrawWallColumnC(uint16_t *p, const uint8_t *texture, fixed_t textureOffsetY, fixed_t scalar, uint32_t count)
+{
+	do
 	{
-		int32_t m = l + ((r - l) >> 1);
-		
-		if ((scalarTable[m] << 6) == d)
-			return 512 - 2 * m;
+		PUT_PIXEL(p, LIGHT_PIXEL(texture[textureOffsetY >> FRACBITS]));
+		p += VIEW_STRIDE;
+		textureOffsetY += scalar;
+	} while (count--);
+}
+
+void IWRAM_CODE ARM_CODE DrawPlaneSpanC(uint16_t *p1, uint16_t *p2, const planetexel_t *texture, fixed_t x, fixed_t y, fixed_t stepX, fixed_t stepY, uint32_t count)
+{
+	do
+	{
+		int32_t tx = (x >> FRACBITS) & 63;
+		int32_t ty = (y >> FRACBITS) & 63;
+		planetexel_t texel = texture[ty * 64 + tx];
+		PUT_PIXEL(p1, FLOOR_PIXEL(texel));
+		p1++;
+		PUT_PIXEL(p2, CEILING_PIXEL(texel));
+		p2++;
+		x += stepX;
+		y += stepY;
+	} while (count--);
+}
+#endif
+
+// Draws a wall column two view columns wide, one word per row when p is word
+// aligned and two halfwords when it is not. There is no ARM or compiled
+// version, it is used by the columns of a reduced resolution.
+static inline __attribute__((always_inline)) void DrawWallColumnPair(uint16_t *p, const uint8_t *texture, fixed_t textureOffsetY, fixed_t scalar, uint32_t count, const uint32_t aligned)
+{
+	do
+	{
+		uint16_t pixel = LIGHT_PIXEL(texture[textureOffsetY >> FRACBITS]);
 		
-		if ((scalarTable[m] << 6) < d)
-			l = m + 1;
+		if (aligned)
+			PUT_PIXEL_PAIR(p, pixel);
 		else
-			r = m - 1;
-	}
-	
-	if (r < 0)
-		return 512;
+		{
+			PUT_PIXEL(p, pixel);
+			PUT_PIXEL(p + 1, pixel);
+		}
+		
+		p += VIEW_STRIDE;
+		textureOffsetY += scalar;
+	} while (count--);
+}
+
+void IWRAM_CODE ARM_CODE DrawWallColumnWide(uint16_t *p, const uint8_t *texture, fixed_t textureOffsetY, fixed_t scalar, uint32_t count)
+{
+	if ((uintptr_t) p & 2)
+		DrawWallColumnPair(p, texture, textureOffsetY, scalar, count, 0);
+	else
+		DrawWallColumnPair(p, texture, textureOffsetY, scalar, count, 1);
+}
+
+// Draw kernels
+//
+// Each kernel is written once as an always inline template whose last
+// parameters pick what it has to handle, and the variants below stamp it out
+// with those fixed, so the tests they make are compiled away. Render() picks
+// the variant once per column, sprite or graphic:
+//
+//   DrawWallSliceFit      a wall no taller than the view
+//   DrawWallSliceClip     a wall cut off at the top and bottom of the view
+//   DrawWallSlice...Wide  the same, two view columns wide
+//   DrawSpriteFit         a sprite wholly inside the view
+//   DrawSpriteClip        a sprite cut off at an edge of the view
+//   DrawSprite...Damage   the same, flashing in the damage colour
+//   DrawGraphicKeyed      a graphic with colour key texels
+//   DrawGraphicOpaque     a graphic without any
+//
+// The host build also has the generic DrawWallSlice, DrawSprite and
+// DrawGraphic the variants replaced, testing everything at run time, and
+// RECORD_KERNEL keeps the calls Render() makes so ./bench -k can time the
+// two on them.
+
+#ifdef HOST
+kernelcall_t *kernelCalls = NULL;
+uint32_t kernelCallCount = 0;
+uint32_t kernelCallLimit = 0;
+
+static void RecordKernel(uint32_t kernel, uint32_t variant, const void *data, int32_t a0, int32_t a1, int32_t a2, int32_t a3, int32_t a4, int32_t a5)
+{
+	if (kernelCallCount >= kernelCallLimit)
+		return;
 	
-	return 512 - 2 * r;
+	kernelcall_t *call = &kernelCalls[kernelCallCount++];
+	call->kernel = kernel;
+	call->variant = variant;
+	call->page = page;
+	call->data = data;
+	call->args[0] = a0;
+	call->args[1] = a1;
+	call->args[2] = a2;
+	call->args[3] = a3;
+	call->args[4] = a4;
+	call->args[5] = a5;
 }
 
-void IWRAM_CODE DrawWallSlice(const uint8_t *texture, uint32_t textureOffsetX, int32_t wallX, int32_t wallY, uint32_t wallHeight)
+#define RECORD_KERNEL(kernel, variant, data, a0, a1, a2, a3, a4, a5) RecordKernel(kernel, variant, data, a0, a1, a2, a3, a4, a5)
+#else
+#define RECORD_KERNEL(kernel, variant, data, a0, a1, a2, a3, a4, a5)
+#endif
+
+static inline __attribute__((always_inline)) void DrawWallSliceKernel(const uint8_t *texture, uint32_t textureOffsetX, int32_t wallX, int32_t wallY, uint32_t wallHeight, const uint32_t clipped, const uint32_t wide)
 {
 	uint32_t count;
 	fixed_t textureOffsetY;
-	fixed_t scalar = scalarTable[(512 - wallHeight) >> 1];
+	fixed_t scalar = scalarTable[(MAX_HEIGHT - wallHeight) >> 1];
 	texture = &texture[textureOffsetX * 64];
 	
-	if (wallY < 0)
+	if (clipped && wallY < 0)
 	{
-		count = 63;
+		count = VIEW_HEIGHT - 1;
 		textureOffsetY = -wallY * scalar;
 		wallY = 0;
 	}
@@ -241,87 +484,149 @@ void IWRAM_CODE DrawWallSlice(const uint8_t *texture, uint32_t textureOffsetX, i
 	
 	uint16_t *p = yTable[page][wallY] + xTable[wallX];
 	
-	do
+	if (wide)
 	{
-		int32_t color = texture[textureOffsetY >> FRACBITS];
-		*p = color << 8 | color;
-		p += SCREEN_WIDTH >> 1;
-		*p = color << 8 | color;
-		p += SCREEN_WIDTH >> 1;
-		textureOffsetY += scalar;
-	} while (count--);
+		DrawWallColumnWide(p, texture, textureOffsetY, scalar, count);
+		return;
+	}
+	
+	// the scalers are generated for wallY = (VIEW_HEIGHT - wallHeight) >> 1, as Render passes
+	scaler_t scaler = scalerTable[wallHeight >> 1];
+	
+	if (scaler)
+		scaler(p, texture);
+	else
+		DrawWallColumn(p, texture, textureOffsetY, scalar, count);
+}
+
+#define WALL_SLICE_VARIANT(name, clipped, wide)\
+void IWRAM_CODE ARM_CODE name(const uint8_t *texture, uint32_t textureOffsetX, int32_t wallX, int32_t wallY, uint32_t wallHeight)\
+{\
+	DrawWallSliceKernel(texture, textureOffsetX, wallX, wallY, wallHeight, clipped, wide);\
+}
+
+WALL_SLICE_VARIANT(DrawWallSliceFit, 0, 0)
+WALL_SLICE_VARIANT(DrawWallSliceClip, 1, 0)
+WALL_SLICE_VARIANT(DrawWallSliceFitWide, 0, 1)
+WALL_SLICE_VARIANT(DrawWallSliceClipWide, 1, 1)
+
+// The first row of a sprite spriteSize tall that shows texel row t or one
+// below it, that is the smallest k with k * scalar >= t << FRACBITS
+static inline __attribute__((always_inline)) int32_t SpriteRow(uint32_t t, uint32_t spriteSize, fixed_t scalar)
+{
+	uint32_t k = (t * spriteSize + 63) >> 6;
+	
+	while (k * scalar < (t << FRACBITS))
+		k++;
+	
+	return k;
 }
 
-void IWRAM_CODE DrawSprite(const uint8_t *sprite, int32_t spriteX, int32_t spriteY, uint32_t spriteSize, fixed_t spriteDistance, uint32_t spriteDamage)
+// Draws the opaque runs of a sprite frame (see sprites.h) in the columns where
+// it is nearer than the wall, so transparent texels are never read
+static inline __attribute__((always_inline)) void DrawSpriteKernel(uint32_t spriteFrame, int32_t spriteX, int32_t spriteY, uint32_t spriteSize, fixed_t spriteDistance, const uint32_t clipped, const uint32_t damage)
 {
-	if (spriteX + (int32_t)spriteSize <= 0 || spriteX > 119)
+	if (clipped && (spriteX + (int32_t)spriteSize <= 0 || spriteX > VIEW_WIDTH - 1))
 		return;
 	
-	uint32_t countX;
-	uint32_t countY;
-	uint32_t yCount;
-	fixed_t spriteOffsetX;
-	fixed_t spriteOffsetY;
-	fixed_t ySpriteOffset;
-	fixed_t scalar = scalarTable[(512 - spriteSize) >> 1];
-	int32_t colorKey = 0x0C;
+	fixed_t scalar = scalarTable[(MAX_HEIGHT - spriteSize) >> 1];
 	int32_t damageColor = 0x2A;
+	const uint16_t *columns = &spriteColumns[spriteFrame * 65];
 	
-	if (spriteX < 0)
-	{
-		countX = spriteSize + spriteX - 1;
-		spriteOffsetX = -spriteX * scalar;
-		spriteX = 0;
-	}
-	else
-	{
-		countX = (spriteX + spriteSize > 119 ? 120 - spriteX : spriteSize) - 1;
-		spriteOffsetX = 0;
-	}
+	int32_t firstX = spriteX;
+	int32_t lastX = spriteX + (int32_t)spriteSize - 1;
 	
-	const uint8_t *spriteColumn = &sprite[(spriteOffsetX >> FRACBITS) * 64];
+	// the rows on screen, counted from the top of the sprite
+	int32_t firstRow = 0;
+	int32_t endRow = spriteSize;
 	
-	if (spriteY < 0)
-	{
-		countY = yCount = 63;
-		spriteOffsetY = ySpriteOffset = -spriteY * scalar;
-		spriteY = 0;
-	}
-	else
+	if (clipped)
 	{
-		countY = yCount = spriteSize - 1;
-		spriteOffsetY = ySpriteOffset = 0;
+		if (firstX < 0)
+			firstX = 0;
+		
+		if (lastX > VIEW_WIDTH - 1)
+			lastX = VIEW_WIDTH - 1;
+		
+		if (spriteY < 0)
+			firstRow = -spriteY;
+		
+		if (spriteY + (int32_t)spriteSize > VIEW_HEIGHT)
+			endRow = VIEW_HEIGHT - spriteY;
 	}
 	
-	uint16_t *p = yTable[page][spriteY] + xTable[spriteX];
-	uint16_t *temp = p;
+	fixed_t spriteOffsetX = (firstX - spriteX) * scalar;
 	
-	do
+	for (int32_t x = firstX; x <= lastX; x++, spriteOffsetX += scalar)
 	{
-		if (spriteDistance < zBuffer[spriteX++])
+		if (spriteDistance >= zBuffer[x])
+			continue;
+		
+		uint32_t column = spriteOffsetX >> FRACBITS;
+		const spriterun_t *run = &spriteRuns[columns[column]];
+		const spriterun_t *end = &spriteRuns[columns[column + 1]];
+		
+		for (; run < end; run++)
 		{
-			do
+			int32_t row = SpriteRow(run->start, spriteSize, scalar);
+			int32_t runEnd = SpriteRow(run->start + run->length, spriteSize, scalar);
+			
+			if (clipped && row < firstRow)
+				row = firstRow;
+			
+			// the row after a run ending on the last texel can be one
+			// past the sprite, as scalar is rounded down
+			if (runEnd > endRow)
+				runEnd = endRow;
+			
+			if (row >= runEnd)
+				continue;
+			
+			uint16_t *p = yTable[page][spriteY + row] + xTable[x];
+			uint32_t count = runEnd - row - 1;
+			
+			if (damage)
+			{
+				do
+				{
+					PUT_PIXEL(p, PIXEL(damageColor));
+					p += VIEW_STRIDE;
+				} while (count--);
+			}
+			else
 			{
-				int32_t color = spriteColumn[spriteOffsetY >> FRACBITS];
-				if (color != colorKey)
-					*p = spriteDamage ? damageColor << 8 | damageColor : color << 8 | color;
-				p += SCREEN_WIDTH >> 1;
-				if (color != colorKey)
-					*p = spriteDamage ? damageColor << 8 | damageColor : color << 8 | color;
-				p += SCREEN_WIDTH >> 1;
-				spriteOffsetY += scalar;
-			} while (countY--);
+				const uint8_t *texels = &spriteTexels[run->texel];
+				fixed_t spriteOffsetY = row * scalar - (run->start << FRACBITS);
+				
+				do
+				{
+					PUT_PIXEL(p, LIGHT_PIXEL(texels[spriteOffsetY >> FRACBITS]));
+					p += VIEW_STRIDE;
+					spriteOffsetY += scalar;
+				} while (count--);
+			}
 		}
-		
-		spriteOffsetX += scalar;
-		spriteColumn = &sprite[(spriteOffsetX >> FRACBITS) * 64];
-		countY = yCount;
-		spriteOffsetY = ySpriteOffset;
-		p = ++temp;
-	} while (countX--);
+	}
 }
 
-void IWRAM_CODE DrawGraphic(const uint8_t *graphic, int32_t srcX, int32_t srcY, int32_t dstX, int32_t dstY, int32_t width, int32_t height)
+#define SPRITE_VARIANT(name, clipped, damage)\
+void IWRAM_CODE name(uint32_t spriteFrame, int32_t spriteX, int32_t spriteY, uint32_t spriteSize, fixed_t spriteDistance)\
+{\
+	DrawSpriteKernel(spriteFrame, spriteX, spriteY, spriteSize, spriteDistance, clipped, damage);\
+}
+
+SPRITE_VARIANT(DrawSpriteFit, 0, 0)
+SPRITE_VARIANT(DrawSpriteFitDamage, 0, 1)
+SPRITE_VARIANT(DrawSpriteClip, 1, 0)
+SPRITE_VARIANT(DrawSpriteClipDamage, 1, 1)
+
+const spritekernel_t spriteKernels[2][2] =
+{
+	{ DrawSpriteFit, DrawSpriteFitDamage },
+	{ DrawSpriteClip, DrawSpriteClipDamage }
+};
+
+static inline __attribute__((always_inline)) void DrawGraphicKernel(const uint8_t *graphic, int32_t srcX, int32_t srcY, int32_t dstX, int32_t dstY, int32_t width, int32_t height, const uint32_t keyed)
 {
 	int32_t colorKey = 0x0C;
 	
@@ -329,7 +634,7 @@ void IWRAM_CODE DrawGraphic(const uint8_t *graphic, int32_t srcX, int32_t srcY,
 	
 	uint16_t *p = yTable[page][dstY] + xTable[dstX];
 	
-	uint32_t countY = 2 * height - 1;
+	uint32_t countY = height - 1;
 	
 	do
 	{
@@ -338,25 +643,106 @@ void IWRAM_CODE DrawGraphic(const uint8_t *graphic, int32_t srcX, int32_t srcY,
 		do
 		{
 			int32_t color = *(graphic++);
-			if (color != colorKey)
-				*p = color << 8 | color;
+			if (!keyed || color != colorKey)
+				PUT_PIXEL(p, PIXEL(color));
 			p++;
 		} while (countX--);
 		
-		if ((countY & 1) == 0)
-			graphic += 64 - width;
-		else
-			graphic -= width;
-		
-		p += (SCREEN_WIDTH >> 1) - width;
+		graphic += 64 - width;
+		p += VIEW_STRIDE - width;
 	} while (countY--);
 }
 
-void IWRAM_CODE DrawRect(int32_t x, int32_t y, int32_t width, int32_t height, uint8_t color)
+#define GRAPHIC_VARIANT(name, keyed)\
+void IWRAM_CODE name(const uint8_t *graphic, int32_t srcX, int32_t srcY, int32_t dstX, int32_t dstY, int32_t width, int32_t height)\
+{\
+	DrawGraphicKernel(graphic, srcX, srcY, dstX, dstY, width, height, keyed);\
+}
+
+GRAPHIC_VARIANT(DrawGraphicOpaque, 0)
+GRAPHIC_VARIANT(DrawGraphicKeyed, 1)
+
+#if HUD_HAND_SCALE > 1
+// A keyed graphic with each texel HUD_HAND_SCALE view texels wide and tall,
+// for the blood wipe to draw the hand as its OBJ shows it, see hud.h
+void DrawGraphicScaled(const uint8_t *graphic, int32_t srcX, int32_t srcY, int32_t dstX, int32_t dstY, int32_t width, int32_t height)
+{
+	int32_t colorKey = 0x0C;
+	
+	graphic = &graphic[srcY * 64 + srcX];
+	
+	uint16_t *p = yTable[page][dstY] + xTable[dstX];
+	
+	for (int32_t y = 0; y < height * HUD_HAND_SCALE; y++)
+	{
+		const uint8_t *row = &graphic[(y / HUD_HAND_SCALE) * 64];
+		
+		for (int32_t x = 0; x < width * HUD_HAND_SCALE; x++)
+		{
+			int32_t color = row[x / HUD_HAND_SCALE];
+			if (color != colorKey)
+				PUT_PIXEL(&p[x], PIXEL(color));
+		}
+		
+		p += VIEW_STRIDE;
+	}
+}
+#endif
+
+#ifdef HOST
+void DrawWallSlice(const uint8_t *texture, uint32_t textureOffsetX, int32_t wallX, int32_t wallY, uint32_t wallHeight)
+{
+	DrawWallSliceKernel(texture, textureOffsetX, wallX, wallY, wallHeight, 1, 0);
+}
+
+void DrawSprite(uint32_t spriteFrame, int32_t spriteX, int32_t spriteY, uint32_t spriteSize, fixed_t spriteDistance, uint32_t spriteDamage)
+{
+	DrawSpriteKernel(spriteFrame, spriteX, spriteY, spriteSize, spriteDistance, 1, spriteDamage);
+}
+
+void DrawGraphic(const uint8_t *graphic, int32_t srcX, int32_t srcY, int32_t dstX, int32_t dstY, int32_t width, int32_t height)
+{
+	DrawGraphicKernel(graphic, srcX, srcY, dstX, dstY, width, height, 1);
+}
+#endif
+
+// Fills a rectangle of the view with one colour, a block of bitmap rows for
+// the blit layer, see blit.h
+void IWRAM_CODE FillRect(int32_t x, int32_t y, int32_t width, int32_t height, uint8_t color)
+{
+	BlitFillRows(yTable[page][y] + xTable[x], PIXEL(color), width, height * ROW_REPEAT, ROW_STRIDE);
+}
+
+// FillRect as Render() calls it, recorded under the screen state
+static inline __attribute__((always_inline)) void FillViewRect(int32_t x, int32_t y, int32_t width, int32_t height, uint8_t color)
+{
+	RECORD_KERNEL(KERNEL_RECT, state, NULL, x, y, width, height, color, 0);
+	FillRect(x, y, width, height, color);
+}
+
+// Fills height rows of one column, for the ragged ends of the ceiling, floor
+// and blood wipe columns past the rows FillViewRect filled whole
+static inline __attribute__((always_inline)) void FillColumn(int32_t x, int32_t y, uint32_t height, uint16_t pixel)
+{
+	uint16_t *p = yTable[page][y] + xTable[x];
+	
+	uint32_t count = height - 1;
+	
+	do
+	{
+		PUT_PIXEL(p, pixel);
+		p += VIEW_STRIDE;
+	} while (count--);
+}
+
+#if defined(HOST) || KERNEL_BENCH
+// The pixel at a time loop FillRect replaced
+void DrawRect(int32_t x, int32_t y, int32_t width, int32_t height, uint8_t color)
 {
 	uint16_t *p = yTable[page][y] + xTable[x];
+	uint16_t pixel = PIXEL(color);
 	
-	uint32_t countY = 2 * height - 1;
+	uint32_t countY = height - 1;
 	
 	do
 	{
@@ -364,17 +750,152 @@ void IWRAM_CODE DrawRect(int32_t x, int32_t y, int32_t width, int32_t height, ui
 		
 		do
 		{
-			*p = color << 8 | color;
+			PUT_PIXEL(p, pixel);
 			p++;
 		} while (countX--);
 		
-		p += (SCREEN_WIDTH >> 1) - width;
+		p += VIEW_STRIDE - width;
 	} while (countY--);
 }
+#endif
+
+static door_t *AddDoor(int32_t mapIndex)
+{
+	if (doorCount == MAX_ENTITIES)
+		return NULL;
+	
+	door_t *door = &doors[doorCount];
+	door->mapIndex = mapIndex;
+	door->state = 4;
+	door->offset = 64 << FRACBITS;
+	door->tics = 0;
+	entityIndex[mapIndex] = doorCount++;
+	
+	return door;
+}
+
+// type is the map tile, 3 or 4
+static enemy_t *AddEnemy(int32_t mapIndex, uint32_t type)
+{
+	if (enemyCount == MAX_ENTITIES)
+		return NULL;
+	
+	enemy_t *enemy = &enemies[enemyCount];
+	enemy->mapIndex = mapIndex;
+	enemy->type = type - 3;
+	enemy->state = 1;
+	enemy->health = 100;
+	enemy->gridX = mapIndex % mapWidth;
+	enemy->gridY = mapIndex / mapWidth;
+	enemy->damageTics = 0;
+	enemy->attackTics = 0;
+	enemy->render = 0;
+	enemy->damage = 0;
+	entityIndex[mapIndex] = enemyCount++;
+	
+	return enemy;
+}
+
+// type is the map tile, 5 or 6
+static health_t *AddHealth(int32_t mapIndex, uint32_t type)
+{
+	if (healthCount == MAX_ENTITIES)
+		return NULL;
+	
+	health_t *health = &healths[healthCount];
+	health->type = type - 5;
+	health->gridX = mapIndex % mapWidth;
+	health->gridY = mapIndex / mapWidth;
+	health->render = 0;
+	entityIndex[mapIndex] = healthCount++;
+	
+	return health;
+}
+
+// The last enemy moves into the removed one's entry
+static void RemoveEnemy(int32_t mapIndex)
+{
+	uint32_t index = entityIndex[mapIndex];
+	enemy_t *last = &enemies[--enemyCount];
+	
+	enemies[index] = *last;
+	entityIndex[last->mapIndex] = index;
+	entityIndex[mapIndex] = NO_ENTITY;
+}
+
+static void RemoveHealth(int32_t mapIndex)
+{
+	uint32_t index = entityIndex[mapIndex];
+	health_t *last = &healths[--healthCount];
+	
+	healths[index] = *last;
+	entityIndex[last->gridY * mapWidth + last->gridX] = index;
+	entityIndex[mapIndex] = NO_ENTITY;
+}
+
+// Builds the entity tables from the door, enemy and health cells of mapData.
+// A cell that does not fit is cleared, so every one left has an entry.
+static void LoadEntities()
+{
+	doorCount = 0;
+	enemyCount = 0;
+	healthCount = 0;
+	memset(entityIndex, NO_ENTITY, sizeof(entityIndex));
+	
+	for (uint32_t mapIndex = 0; mapIndex < mapWidth * mapHeight; mapIndex++)
+	{
+		uint32_t type = mapData[mapIndex];
+		void *entity;
+		
+		if (type == 2)
+			entity = AddDoor(mapIndex);
+		else if (type == 3 || type == 4)
+			entity = AddEnemy(mapIndex, type);
+		else if (type == 5 || type == 6)
+			entity = AddHealth(mapIndex, type);
+		else
+			continue;
+		
+		if (!entity)
+		{
+			DebugLog("level %lu: no room for tile %lu at %lu,%lu", (unsigned long) level, (unsigned long) type, (unsigned long) (mapIndex % mapWidth), (unsigned long) (mapIndex / mapWidth));
+			mapData[mapIndex] = 0;
+		}
+	}
+}
+
+void LoadLevel()
+{
+	const uint32_t *levelData = levels[level - 1];
+	int32_t cameraGridX = levelData[0];
+	int32_t cameraGridY = levelData[1];
+	cameraX = (cameraGridX * 64 + 32) << FRACBITS;
+	cameraY = (cameraGridY * 64 + 32) << FRACBITS;
+	cameraAngle = levelData[2];
+	memcpy(mapData, &levelData[7], mapWidth * mapHeight * sizeof(uint32_t));
+	LoadEntities();
+	mapVersion++;
+}
+
+// The exit tile's way into the next level, or to the end screen after the last
+void NextLevel()
+{
+	level++;
+	
+	if (level <= numLevels)
+	{
+		LoadLevel();
+	}
+	else
+	{
+		level = 1;
+		state = 4;
+	}
+}
 
 void Update()
 {
-	uint16_t keys = keysDown();
+	uint16_t keys = inputDown;
 	
 	restartLevelPressed = 0;
 	
@@ -386,7 +907,7 @@ void Update()
 		if (keys & KEY_SELECT)
 			solidPlanes = !solidPlanes;
 		
-		keys = keysHeld();
+		keys = inputHeld;
 		
 		oldCameraX = cameraX;
 		oldCameraY = cameraY;
@@ -477,7 +998,9 @@ void Update()
 		{
 			if (health < 100)
 			{
+				RemoveHealth(mapIndex);
 				mapData[mapIndex] = 0;
+				mapVersion++;
 				
 				health += 10;
 				
@@ -489,7 +1012,9 @@ void Update()
 		{
 			if (health < 100)
 			{
+				RemoveHealth(mapIndex);
 				mapData[mapIndex] = 0;
+				mapVersion++;
 				
 				health += 25;
 				
@@ -499,36 +1024,18 @@ void Update()
 		}
 		else if (mapData[mapIndex] == 8)
 		{
-			level++;
-			
-			if (level <= numLevels)
-			{
-				const uint32_t *levelData = levels[level - 1];
-				int32_t cameraGridX = levelData[0];
-				int32_t cameraGridY = levelData[1];
-				cameraX = (cameraGridX * 64 + 32) << FRACBITS;
-				cameraY = (cameraGridY * 64 + 32) << FRACBITS;
-				cameraAngle = levelData[2];
-				memcpy(mapData, &levelData[7], mapWidth * mapHeight * sizeof(uint32_t));
-			}
-			else
-			{
-				level = 1;
-				state = 4;
-			}
+			NextLevel();
 		}
 		
 		mapIndex = (ty - 1) * mapWidth + tx;
 		
 		if (mapData[mapIndex] == 2)
 		{
-			door_t *door = &doors[(((ty - 1) & 7) << 3) + (tx & 7)];
+			door_t *door = &doors[entityIndex[mapIndex]];
 			
-			if (door->mapIndex != mapIndex)
+			if (door->state == 4)
 			{
-				door->mapIndex = mapIndex;
 				door->state = 0;
-				door->offset = 64 << FRACBITS;
 				door->tics = 0;
 			}
 			
@@ -543,33 +1050,15 @@ void Update()
 		}
 		else if (mapData[mapIndex] == 3 || mapData[mapIndex] == 4)
 		{
-			enemy_t *enemy1 = &enemies[(((ty - 1) & 7) << 3) + (tx & 7)];
+			enemy_t *enemy1 = &enemies[entityIndex[mapIndex]];
+			enemy_t *enemy2;
 			
-			if (enemy1->mapIndex != mapIndex)
-			{
-				enemy1->mapIndex = mapIndex;
-				enemy1->type = mapData[mapIndex];
-				enemy1->state = 1;
-				enemy1->health = 100;
-				enemy1->damageTics = 0;
-				enemy1->attackTics = 0;
-				enemy1->damage = 0;
-			}
-			
-			if (mapData[(ty + 1) * mapWidth + tx] == 0)
+			if (mapData[(ty + 1) * mapWidth + tx] == 0 && (enemy2 = AddEnemy((ty + 1) * mapWidth + tx, 4)))
 			{
 				mapData[(ty + 1) * mapWidth + tx] = 4;
+				mapVersion++;
 				
-				enemy_t *enemy2 = &enemies[(((ty + 1) & 7) << 3) + (tx & 7)];
-				enemy2->mapIndex = (ty + 1) * mapWidth + tx;
-				enemy2->type = 1;
-				enemy2->state = 1;
-				enemy2->health = 100;
-				enemy2->damageTics = 0;
-				enemy2->attackTics = 0;
-				enemy2->damage = 0;
-				
-				if (rand() % 2 == 0)
+				if (Random() % 2 == 0)
 					enemy1->state = 2;
 				else
 					enemy2->state = 2;
@@ -617,12 +1106,12 @@ void Update()
 					if (enemy1->state == 0)
 					{
 						mapData[mapIndex] = 7;
-						enemy1->mapIndex = -1;
-						enemy1->type = 0;
-						enemy1->gridX = 0;
-						enemy1->gridY = 0;
-						enemy_t *enemy2 = &enemies[(((ty + 1) & 7) << 3) + (tx & 7)];
-						enemy2->state = 2;
+						mapVersion++;
+						RemoveEnemy(mapIndex);
+						
+						// the other enemy of the pair takes over the attack
+						if (mapData[(ty + 1) * mapWidth + tx] == 3 || mapData[(ty + 1) * mapWidth + tx] == 4)
+							enemies[entityIndex[(ty + 1) * mapWidth + tx]].state = 2;
 					}
 				}
 			}
@@ -632,13 +1121,11 @@ void Update()
 		
 		if (mapData[mapIndex] == 2)
 		{
-			door_t *door = &doors[(((ty + 1) & 7) << 3) + (tx & 7)];
+			door_t *door = &doors[entityIndex[mapIndex]];
 			
-			if (door->mapIndex != mapIndex)
+			if (door->state == 4)
 			{
-				door->mapIndex = mapIndex;
 				door->state = 0;
-				door->offset = 64 << FRACBITS;
 				door->tics = 0;
 			}
 			
@@ -653,33 +1140,15 @@ void Update()
 		}
 		else if (mapData[mapIndex] == 3 || mapData[mapIndex] == 4)
 		{
-			enemy_t *enemy1 = &enemies[(((ty + 1) & 7) << 3) + (tx & 7)];
-			
-			if (enemy1->mapIndex != mapIndex)
-			{
-				enemy1->mapIndex = mapIndex;
-				enemy1->type = mapData[mapIndex];
-				enemy1->state = 1;
-				enemy1->health = 100;
-				enemy1->damageTics = 0;
-				enemy1->attackTics = 0;
-				enemy1->damage = 0;
-			}
+			enemy_t *enemy1 = &enemies[entityIndex[mapIndex]];
+			enemy_t *enemy2;
 			
-			if (mapData[(ty - 1) * mapWidth + tx] == 0)
+			if (mapData[(ty - 1) * mapWidth + tx] == 0 && (enemy2 = AddEnemy((ty - 1) * mapWidth + tx, 4)))
 			{
 				mapData[(ty - 1) * mapWidth + tx] = 4;
+				mapVersion++;
 				
-				enemy_t *enemy2 = &enemies[(((ty - 1) & 7) << 3) + (tx & 7)];
-				enemy2->mapIndex = (ty - 1) * mapWidth + tx;
-				enemy2->type = 1;
-				enemy2->state = 1;
-				enemy2->health = 100;
-				enemy2->damageTics = 0;
-				enemy2->attackTics = 0;
-				enemy2->damage = 0;
-				
-				if (rand() % 2 == 0)
+				if (Random() % 2 == 0)
 					enemy1->state = 2;
 				else
 					enemy2->state = 2;
@@ -727,12 +1196,12 @@ void Update()
 					if (enemy1->state == 0)
 					{
 						mapData[mapIndex] = 7;
-						enemy1->mapIndex = -1;
-						enemy1->type = 0;
-						enemy1->gridX = 0;
-						enemy1->gridY = 0;
-						enemy_t *enemy2 = &enemies[(((ty - 1) & 7) << 3) + (tx & 7)];
-						enemy2->state = 2;
+						mapVersion++;
+						RemoveEnemy(mapIndex);
+						
+						// the other enemy of the pair takes over the attack
+						if (mapData[(ty - 1) * mapWidth + tx] == 3 || mapData[(ty - 1) * mapWidth + tx] == 4)
+							enemies[entityIndex[(ty - 1) * mapWidth + tx]].state = 2;
 					}
 				}
 			}
@@ -742,13 +1211,11 @@ void Update()
 		
 		if (mapData[mapIndex] == 2)
 		{
-			door_t *door = &doors[((ty & 7) << 3) + ((tx - 1) & 7)];
+			door_t *door = &doors[entityIndex[mapIndex]];
 			
-			if (door->mapIndex != mapIndex)
+			if (door->state == 4)
 			{
-				door->mapIndex = mapIndex;
 				door->state = 0;
-				door->offset = 64 << FRACBITS;
 				door->tics = 0;
 			}
 			
@@ -763,33 +1230,15 @@ void Update()
 		}
 		else if (mapData[mapIndex] == 3 || mapData[mapIndex] == 4)
 		{
-			enemy_t *enemy1 = &enemies[((ty & 7) << 3) + ((tx - 1) & 7)];
+			enemy_t *enemy1 = &enemies[entityIndex[mapIndex]];
+			enemy_t *enemy2;
 			
-			if (enemy1->mapIndex != mapIndex)
-			{
-				enemy1->mapIndex = mapIndex;
-				enemy1->type = mapData[mapIndex];
-				enemy1->state = 1;
-				enemy1->health = 100;
-				enemy1->damageTics = 0;
-				enemy1->attackTics = 0;
-				enemy1->damage = 0;
-			}
-			
-			if (mapData[ty * mapWidth + (tx + 1)] == 0)
+			if (mapData[ty * mapWidth + (tx + 1)] == 0 && (enemy2 = AddEnemy(ty * mapWidth + (tx + 1), 4)))
 			{
 				mapData[ty * mapWidth + (tx + 1)] = 4;
+				mapVersion++;
 				
-				enemy_t *enemy2 = &enemies[((ty & 7) << 3) + ((tx + 1) & 7)];
-				enemy2->mapIndex = ty * mapWidth + (tx + 1);
-				enemy2->type = 1;
-				enemy2->state = 1;
-				enemy2->health = 100;
-				enemy2->damageTics = 0;
-				enemy2->attackTics = 0;
-				enemy2->damage = 0;
-				
-				if (rand() % 2 == 0)
+				if (Random() % 2 == 0)
 					enemy1->state = 2;
 				else
 					enemy2->state = 2;
@@ -837,12 +1286,12 @@ void Update()
 					if (enemy1->state == 0)
 					{
 						mapData[mapIndex] = 7;
-						enemy1->mapIndex = -1;
-						enemy1->type = 0;
-						enemy1->gridX = 0;
-						enemy1->gridY = 0;
-						enemy_t *enemy2 = &enemies[((ty & 7) << 3) + ((tx + 1) & 7)];
-						enemy2->state = 2;
+						mapVersion++;
+						RemoveEnemy(mapIndex);
+						
+						// the other enemy of the pair takes over the attack
+						if (mapData[ty * mapWidth + (tx + 1)] == 3 || mapData[ty * mapWidth + (tx + 1)] == 4)
+							enemies[entityIndex[ty * mapWidth + (tx + 1)]].state = 2;
 					}
 				}
 			}
@@ -852,13 +1301,11 @@ void Update()
 		
 		if (mapData[mapIndex] == 2)
 		{
-			door_t *door = &doors[((ty & 7) << 3) + ((tx + 1) & 7)];
+			door_t *door = &doors[entityIndex[mapIndex]];
 			
-			if (door->mapIndex != mapIndex)
+			if (door->state == 4)
 			{
-				door->mapIndex = mapIndex;
 				door->state = 0;
-				door->offset = 64 << FRACBITS;
 				door->tics = 0;
 			}
 			
@@ -873,33 +1320,15 @@ void Update()
 		}
 		else if (mapData[mapIndex] == 3 || mapData[mapIndex] == 4)
 		{
-			enemy_t *enemy1 = &enemies[((ty & 7) << 3) + ((tx + 1) & 7)];
-			
-			if (enemy1->mapIndex != mapIndex)
-			{
-				enemy1->mapIndex = mapIndex;
-				enemy1->type = mapData[mapIndex];
-				enemy1->state = 1;
-				enemy1->health = 100;
-				enemy1->damageTics = 0;
-				enemy1->attackTics = 0;
-				enemy1->damage = 0;
-			}
+			enemy_t *enemy1 = &enemies[entityIndex[mapIndex]];
+			enemy_t *enemy2;
 			
-			if (mapData[ty * mapWidth + (tx - 1)] == 0)
+			if (mapData[ty * mapWidth + (tx - 1)] == 0 && (enemy2 = AddEnemy(ty * mapWidth + (tx - 1), 4)))
 			{
 				mapData[ty * mapWidth + (tx - 1)] = 4;
+				mapVersion++;
 				
-				enemy_t *enemy2 = &enemies[((ty & 7) << 3) + ((tx - 1) & 7)];
-				enemy2->mapIndex = ty * mapWidth + (tx - 1);
-				enemy2->type = 1;
-				enemy2->state = 1;
-				enemy2->health = 100;
-				enemy2->damageTics = 0;
-				enemy2->attackTics = 0;
-				enemy2->damage = 0;
-				
-				if (rand() % 2 == 0)
+				if (Random() % 2 == 0)
 					enemy1->state = 2;
 				else
 					enemy2->state = 2;
@@ -947,66 +1376,62 @@ void Update()
 					if (enemy1->state == 0)
 					{
 						mapData[mapIndex] = 7;
-						enemy1->mapIndex = -1;
-						enemy1->type = 0;
-						enemy1->gridX = 0;
-						enemy1->gridY = 0;
-						enemy_t *enemy2 = &enemies[((ty & 7) << 3) + ((tx - 1) & 7)];
-						enemy2->state = 2;
+						mapVersion++;
+						RemoveEnemy(mapIndex);
+						
+						// the other enemy of the pair takes over the attack
+						if (mapData[ty * mapWidth + (tx - 1)] == 3 || mapData[ty * mapWidth + (tx - 1)] == 4)
+							enemies[entityIndex[ty * mapWidth + (tx - 1)]].state = 2;
 					}
 				}
 			}
 		}
 		
-		for (int32_t i = 0; i < 64; i++)
+		for (uint32_t i = 0; i < doorCount; i++)
 		{
 			door_t *door = &doors[i];
 			
-			if (door->mapIndex != -1)
+			if (door->state == 0)
 			{
-				if (door->state == 0)
+				door->tics++;
+				
+				if (door->tics == 30)
 				{
-					door->tics++;
-					
-					if (door->tics == 30)
-					{
-						door->state = 1;
-						door->tics = 0;
-					}
+					door->state = 1;
+					door->tics = 0;
 				}
-				else if (door->state == 1)
+			}
+			else if (door->state == 1)
+			{
+				door->offset -= 279620;
+				
+				if (door->offset < 0)
 				{
-					door->offset -= 279620;
-					
-					if (door->offset < 0)
-					{
-						door->state = 2;
-						door->offset = 0;
-					}
+					door->state = 2;
+					door->offset = 0;
 				}
-				else if (door->state == 2)
+			}
+			else if (door->state == 2)
+			{
+				if (door->mapIndex != (ty * mapWidth + tx))
 				{
-					if (door->mapIndex != (ty * mapWidth + tx))
+					door->tics++;
+					
+					if (door->tics == 30)
 					{
-						door->tics++;
-						
-						if (door->tics == 30)
-						{
-							door->state = 3;
-							door->tics = 0;
-						}
+						door->state = 3;
+						door->tics = 0;
 					}
 				}
-				else if (door->state == 3)
+			}
+			else if (door->state == 3)
+			{
+				door->offset += 279620;
+				
+				if (door->offset > (64 << FRACBITS))
 				{
-					door->offset += 279620;
-					
-					if (door->offset > (64 << FRACBITS))
-					{
-						door->mapIndex = -1;
-						door->state = 0;
-						door->offset = 64 << FRACBITS;
-					}
+					door->state = 4;
+					door->offset = 64 << FRACBITS;
 				}
 			}
 		}
@@ -1027,17 +1452,17 @@ void Update()
 		{
 			uint32_t area = 0;
 			
-			for (uint32_t i = 0; i < 120; i++)
+			for (uint32_t i = 0; i < VIEW_WIDTH; i++)
 			{
 				bloodHeight[i] += bloodSpeed[i];
 				
-				if (bloodHeight[i] > 64)
-					bloodHeight[i] = 64;
+				if (bloodHeight[i] > VIEW_HEIGHT)
+					bloodHeight[i] = VIEW_HEIGHT;
 
 				area += bloodHeight[i];
 			}
 			
-			if (area == 7680)
+			if (area == VIEW_WIDTH * VIEW_HEIGHT)
 				state = 3;
 
 			bloodTics = 0;
@@ -1047,17 +1472,11 @@ void Update()
 	{
 		if (state < 4 && restartLevelPressed)
 		{
-			const uint32_t *levelData = levels[level - 1];
-			int32_t cameraGridX = levelData[0];
-			int32_t cameraGridY = levelData[1];
-			cameraX = (cameraGridX * 64 + 32) << FRACBITS;
-			cameraY = (cameraGridY * 64 + 32) << FRACBITS;
-			cameraAngle = levelData[2];
-			memcpy(mapData, &levelData[7], mapWidth * mapHeight * sizeof(uint32_t));
+			LoadLevel();
 			state = 1;
 			health = 100;
 			
-			for (uint32_t i = 0; i < 120; i++)
+			for (uint32_t i = 0; i < VIEW_WIDTH; i++)
 				bloodHeight[i] = 0;
 		}
 		else if (state == 4 && restartLevelPressed)
@@ -1067,453 +1486,1454 @@ void Update()
 	}
 }
 
-void IWRAM_CODE Render()
+static uint32_t HashBytes(uint32_t hash, const void *data, uint32_t size)
 {
-	if (state == 1 || state == 0)
+	const uint8_t *p = data;
+	
+	while (size--)
+		hash = (hash ^ *(p++)) * 16777619;
+	
+	return hash;
+}
+
+// FNV-1a of the state Update() owns. The enemies' render flags are left out,
+// Render() sets them as it finds the sprites.
+uint32_t StateHash()
+{
+	uint32_t hash = 2166136261u;
+	
+	hash = HashBytes(hash, &cameraX, sizeof(cameraX));
+	hash = HashBytes(hash, &cameraY, sizeof(cameraY));
+	hash = HashBytes(hash, &cameraAngle, sizeof(cameraAngle));
+	hash = HashBytes(hash, &health, sizeof(health));
+	hash = HashBytes(hash, &state, sizeof(state));
+	hash = HashBytes(hash, &level, sizeof(level));
+	hash = HashBytes(hash, &randomState, sizeof(randomState));
+	hash = HashBytes(hash, mapData, sizeof(mapData));
+	hash = HashBytes(hash, doors, doorCount * sizeof(door_t));
+	hash = HashBytes(hash, &enemyCount, sizeof(enemyCount));
+	
+	for (uint32_t i = 0; i < enemyCount; i++)
 	{
-		plane.minX = 120;
-		plane.maxX = -1;
-		
-		plane.pad1 = 64;
+		enemy_t *enemy = &enemies[i];
 		
-		for (int32_t i = 0; i < 120; i++)
-			plane.top[i] = 64;
-		
-		plane.pad2 = 64;
-		
-		angle_t rayAngle = (cameraAngle + 59) & ANGLESMASK;
-		
-		for (int32_t i = 0; i < 120; i++)
+		hash = HashBytes(hash, &enemy->mapIndex, sizeof(enemy->mapIndex));
+		hash = HashBytes(hash, &enemy->state, sizeof(enemy->state));
+		hash = HashBytes(hash, &enemy->health, sizeof(enemy->health));
+		hash = HashBytes(hash, &enemy->damageTics, sizeof(enemy->damageTics));
+		hash = HashBytes(hash, &enemy->attackTics, sizeof(enemy->attackTics));
+		hash = HashBytes(hash, &enemy->damage, sizeof(enemy->damage));
+	}
+	
+	return hash;
+}
+
+// Adds an enemy or health cell to this frame's sprite candidates
+static inline __attribute__((always_inline)) void MarkSprite(int32_t mapIndex, uint32_t type)
+{
+	uint32_t *render = type <= 4 ? &enemies[entityIndex[mapIndex]].render : &healths[entityIndex[mapIndex]].render;
+	
+	if (!*render)
+	{
+		*render = 1;
+		spriteCandidates[spriteCandidateCount++] = mapIndex;
+	}
+}
+
+// An enemy or health cell a ray passes, type 3 to 6
+static inline __attribute__((always_inline)) void SeeSprite(rayhit_t *hit, int32_t gridX, int32_t gridY, uint32_t type)
+{
+	int32_t mapIndex = gridY * mapWidth + gridX;
+	MarkSprite(mapIndex, type);
+	
+#if RAY_CACHE
+	if (hit->numSprites < RAY_CACHE_CELLS)
+		hit->spriteCells[hit->numSprites] = mapIndex;
+	
+	if (hit->numSprites <= RAY_CACHE_CELLS)
+		hit->numSprites++;
+#endif
+}
+
+// A door cell a ray enters, returns how far the door is closed in texels
+static inline __attribute__((always_inline)) int32_t SeeDoor(rayhit_t *hit, int32_t gridX, int32_t gridY)
+{
+	int32_t mapIndex = gridY * mapWidth + gridX;
+	
+#if RAY_CACHE
+	if (hit->numDoors < RAY_CACHE_CELLS)
+		hit->doorCells[hit->numDoors] = mapIndex;
+	
+	if (hit->numDoors <= RAY_CACHE_CELLS)
+		hit->numDoors++;
+#endif
+	
+	return doors[entityIndex[mapIndex]].offset >> FRACBITS;
+}
+
+// Traces the ray at rayAngle from the camera. Where it hit and the wall
+// texture column there are left in hit, and the sprites it passed are marked
+// to be drawn. Returns the hit's distance along the view direction.
+static inline __attribute__((always_inline)) fixed_t TraceRay(rayhit_t *hit, angle_t rayAngle, fixed_t viewCos, fixed_t viewSin, fixed_t cellX, fixed_t cellY)
+{
+	const ray_t *ray = &rayTable[rayAngle];
+	
+	fixed_t horizontalIntersectionY = cellY + ray->horizontalEdgeY;
+	fixed_t horizontalStepY = ray->horizontalStepY;
+	fixed_t horizontalIntersectionX = cameraX - fixedMulFast(horizontalIntersectionY - cameraY, ray->cot);
+	fixed_t horizontalStepX = ray->horizontalStepX;
+	fixed_t horizontalIntersectionDistance;
+	uint32_t horizontalIntersectionType = 0;
+	int32_t horizontalDoorOffset = 0;
+	
+	fixed_t verticalIntersectionX = cellX + ray->verticalEdgeX;
+	fixed_t verticalStepX = ray->verticalStepX;
+	fixed_t verticalIntersectionY = cameraY - fixedMulFast(verticalIntersectionX - cameraX, ray->tan);
+	fixed_t verticalStepY = ray->verticalStepY;
+	fixed_t verticalIntersectionDistance;
+	uint32_t verticalIntersectionType = 0;
+	int32_t verticalDoorOffset = 0;
+	
+#if DDA_RAYCASTER
+	// Visit the crossings of both walks in the order the ray reaches them.
+	// |dy| * |cos| and |dx| * |sin| are both the distance along the ray
+	// scaled by |sin * cos|, so they order the crossings. |dy| and |dx| are
+	// taken in quarter map units, at most 2^14 on a 64 cell map, so with
+	// |sin| and |cos| under 2^16 the lengths fit 32 bits. Once one walk
+	// hits, the other only continues DDA_HIT_MARGIN past it.
+	int32_t horizontalLength = (rayAngle == 0 || rayAngle == 256) ? INT32_MAX : (abs(horizontalIntersectionY - cameraY) >> 14) * ray->absCos;
+	int32_t horizontalLengthStep = ray->absCos << 8;
+	int32_t verticalLength = (rayAngle == 128 || rayAngle == 384) ? INT32_MAX : (abs(verticalIntersectionX - cameraX) >> 14) * ray->absSin;
+	int32_t verticalLengthStep = ray->absSin << 8;
+	int32_t hitMargin = ray->hitMargin;
+#if LIGHTING
+	// nothing past the fog is drawn, so the walks stop there, though not
+	// along the axes, where every length is 0
+	int32_t hitLength = ray->fogLength;
+#else
+	int32_t hitLength = INT32_MAX;
+#endif
+	
+	horizontalIntersectionDistance = INT_MAX;
+	verticalIntersectionDistance = INT_MAX;
+	
+	while (1)
+	{
+		if (horizontalLength <= verticalLength)
 		{
-			fixed_t horizontalIntersectionY;
-			fixed_t stepY;
-			
-			if (rayAngle < 256)
-			{
-				horizontalIntersectionY = (cameraY >> 22) * (64 << FRACBITS);
-				stepY = -64 << FRACBITS;
-			}
-			else
-			{
-				horizontalIntersectionY = (cameraY >> 22) * (64 << FRACBITS) + (64 << FRACBITS);
-				stepY = 64 << FRACBITS;
-			}
+			if (horizontalLength == INT32_MAX || horizontalLength > hitLength)
+				break;
 			
-			fixed_t horizontalIntersectionX = cameraX - fixedMul(horizontalIntersectionY - cameraY, fixedCot(rayAngle));
-			fixed_t stepX = -fixedMul(stepY, fixedCot(rayAngle));
-			fixed_t horizontalIntersectionDistance;
-			uint32_t horizontalIntersectionType;
-			int32_t horizontalDoorOffset;
+			int32_t gridX = horizontalIntersectionX >> 22;
+			int32_t gridY = (horizontalIntersectionY >> 22) - (horizontalStepY < 0 ? 1 : 0);
 			
-			if (rayAngle == 0 || rayAngle == 256)
-				horizontalIntersectionDistance = INT_MAX;
-			else
+			if (gridX < 0 || gridY < 0 || gridX >= mapWidth || gridY >= mapHeight)
 			{
-				while (1)
-				{
-					int32_t gridX = horizontalIntersectionX >> 22;
-					int32_t gridY = (horizontalIntersectionY >> 22) - (stepY < 0 ? 1 : 0);
-					
-					if (gridX < 0 || gridY < 0 || gridX >= mapWidth || gridY >= mapHeight)
-					{
-						horizontalIntersectionDistance = INT_MAX;
-						break;
-					}
-					
-					horizontalIntersectionType = mapData[gridY * mapWidth + gridX];
-					
-					if (horizontalIntersectionType == 1)
-					{
-						horizontalIntersectionDistance = fixedMul(horizontalIntersectionX - cameraX, fixedCos(cameraAngle)) - fixedMul(horizontalIntersectionY - cameraY, fixedSin(cameraAngle));
-						break;
-					}
-					else if (horizontalIntersectionType == 2 && (((horizontalIntersectionX + (stepX >> 1)) >> FRACBITS) & 63) < (horizontalDoorOffset = (doors[((gridY & 7) << 3) + (gridX & 7)].mapIndex == (gridY * mapWidth + gridX) ? doors[((gridY & 7) << 3) + (gridX & 7)].offset >> FRACBITS : 64)))
-					{
-						horizontalIntersectionX += stepX >> 1;
-						horizontalIntersectionY += stepY >> 1;
-						horizontalIntersectionDistance = fixedMul(horizontalIntersectionX - cameraX, fixedCos(cameraAngle)) - fixedMul(horizontalIntersectionY - cameraY, fixedSin(cameraAngle));
-						break;
-					}
-					else if (horizontalIntersectionType == 3 || horizontalIntersectionType == 4)
-					{
-						enemy_t *enemy = &enemies[((gridY & 7) << 3) + (gridX & 7)];
-						enemy->type = horizontalIntersectionType - 3;
-						enemy->gridX = gridX;
-						enemy->gridY = gridY;
-						enemy->render = 1;
-					}
-					else if (horizontalIntersectionType == 5 || horizontalIntersectionType == 6)
-					{
-						health_t *health = &healths[((gridY & 7) << 3) + (gridX & 7)];
-						health->type = horizontalIntersectionType - 5;
-						health->gridX = gridX;
-						health->gridY = gridY;
-						health->render = 1;
-					}
-					
-					horizontalIntersectionX += stepX;
-					horizontalIntersectionY += stepY;
-				}
+				horizontalLength = INT32_MAX;
+				continue;
 			}
 			
-			fixed_t verticalIntersectionX;
+			horizontalIntersectionType = mapData[gridY * mapWidth + gridX];
 			
-			if (rayAngle >= 128 && rayAngle < 384)
+			if (horizontalIntersectionType == 1)
 			{
-				verticalIntersectionX = (cameraX >> 22) * (64 << FRACBITS);
-				stepX = -64 << FRACBITS;
+				horizontalIntersectionDistance = fixedMulFast(horizontalIntersectionX - cameraX, viewCos) - fixedMulFast(horizontalIntersectionY - cameraY, viewSin);
+				
+				if (horizontalLength + hitMargin < hitLength)
+					hitLength = horizontalLength + hitMargin;
+				
+				horizontalLength = INT32_MAX;
+				continue;
 			}
-			else
+			else if (horizontalIntersectionType == 2 && (((horizontalIntersectionX + (horizontalStepX >> 1)) >> FRACBITS) & 63) < (horizontalDoorOffset = SeeDoor(hit, gridX, gridY)))
 			{
-				verticalIntersectionX = (cameraX >> 22) * (64 << FRACBITS) + (64 << FRACBITS);
-				stepX = 64 << FRACBITS;
+				horizontalIntersectionX += horizontalStepX >> 1;
+				horizontalIntersectionY += horizontalStepY >> 1;
+				horizontalIntersectionDistance = fixedMulFast(horizontalIntersectionX - cameraX, viewCos) - fixedMulFast(horizontalIntersectionY - cameraY, viewSin);
+				
+				if (horizontalLength + (horizontalLengthStep >> 1) + hitMargin < hitLength)
+					hitLength = horizontalLength + (horizontalLengthStep >> 1) + hitMargin;
+				
+				horizontalLength = INT32_MAX;
+				continue;
 			}
+			else if (horizontalIntersectionType >= 3 && horizontalIntersectionType <= 6)
+				SeeSprite(hit, gridX, gridY, horizontalIntersectionType);
+			
+			horizontalIntersectionX += horizontalStepX;
+			horizontalIntersectionY += horizontalStepY;
+			horizontalLength += horizontalLengthStep;
+		}
+		else
+		{
+			if (verticalLength > hitLength)
+				break;
 			
-			fixed_t verticalIntersectionY = cameraY - fixedMul(verticalIntersectionX - cameraX, fixedTan(rayAngle));
-			stepY = -fixedMul(stepX, fixedTan(rayAngle));
-			fixed_t verticalIntersectionDistance;
-			uint32_t verticalIntersectionType;
-			int32_t verticalDoorOffset;
+			int32_t gridX = (verticalIntersectionX >> 22) - (verticalStepX < 0 ? 1 : 0);
+			int32_t gridY = verticalIntersectionY >> 22;
 			
-			if (rayAngle == 128 || rayAngle == 384)
-				verticalIntersectionDistance = INT_MAX;
-			else
+			if (gridX < 0 || gridY < 0 || gridX >= mapWidth || gridY >= mapHeight)
 			{
-				while (1)
-				{
-					int32_t gridX = (verticalIntersectionX >> 22) - (stepX < 0 ? 1 : 0);
-					int32_t gridY = verticalIntersectionY >> 22;
-					
-					if (gridX < 0 || gridY < 0 || gridX >= mapWidth || gridY >= mapHeight)
-					{
-						verticalIntersectionDistance = INT_MAX;
-						break;
-					}
-					
-					verticalIntersectionType = mapData[gridY * mapWidth + gridX];
-					
-					if (verticalIntersectionType == 1)
-					{
-						verticalIntersectionDistance = fixedMul(verticalIntersectionX - cameraX, fixedCos(cameraAngle)) - fixedMul((verticalIntersectionY - cameraY), fixedSin(cameraAngle));
-						break;
-					}
-					else if (verticalIntersectionType == 2 && (((verticalIntersectionY + (stepY >> 1)) >> FRACBITS) & 63) < (verticalDoorOffset = (doors[((gridY & 7) << 3) + (gridX & 7)].mapIndex == (gridY * mapWidth + gridX) ? doors[((gridY & 7) << 3) + (gridX & 7)].offset >> FRACBITS : 64)))
-					{
-						verticalIntersectionX += stepX >> 1;
-						verticalIntersectionY += stepY >> 1;
-						verticalIntersectionDistance = fixedMul(verticalIntersectionX - cameraX, fixedCos(cameraAngle)) - fixedMul((verticalIntersectionY - cameraY), fixedSin(cameraAngle));
-						break;
-					}
-					else if (verticalIntersectionType == 3 || verticalIntersectionType == 4)
-					{
-						enemy_t *enemy = &enemies[((gridY & 7) << 3) + (gridX & 7)];
-						enemy->type = verticalIntersectionType - 3;
-						enemy->gridX = gridX;
-						enemy->gridY = gridY;
-						enemy->render = 1;
-					}
-					else if (verticalIntersectionType == 5 || verticalIntersectionType == 6)
-					{
-						health_t *health = &healths[((gridY & 7) << 3) + (gridX & 7)];
-						health->type = verticalIntersectionType - 5;
-						health->gridX = gridX;
-						health->gridY = gridY;
-						health->render = 1;
-					}
-					
-					verticalIntersectionX += stepX;
-					verticalIntersectionY += stepY;
-				}
+				verticalLength = INT32_MAX;
+				continue;
 			}
 			
-			fixed_t distance;
-			const uint8_t *texture;
-			int32_t textureOffsetX;
+			verticalIntersectionType = mapData[gridY * mapWidth + gridX];
 			
-			if (horizontalIntersectionDistance < verticalIntersectionDistance)
+			if (verticalIntersectionType == 1)
 			{
-				distance = horizontalIntersectionDistance;
-				texture = &graphicsBitmap[0];
-				textureOffsetX = (horizontalIntersectionX >> FRACBITS) & 63;
+				verticalIntersectionDistance = fixedMulFast(verticalIntersectionX - cameraX, viewCos) - fixedMulFast((verticalIntersectionY - cameraY), viewSin);
 				
-				if (horizontalIntersectionType == 2)
-				{
-					texture = &graphicsBitmap[8192];
-					textureOffsetX += 64 - horizontalDoorOffset;
-				}
+				if (verticalLength + hitMargin < hitLength)
+					hitLength = verticalLength + hitMargin;
 				
-				if (horizontalIntersectionType != 2 && rayAngle >= 256)
-					textureOffsetX = 63 - textureOffsetX;
+				verticalLength = INT32_MAX;
+				continue;
 			}
-			else
+			else if (verticalIntersectionType == 2 && (((verticalIntersectionY + (verticalStepY >> 1)) >> FRACBITS) & 63) < (verticalDoorOffset = SeeDoor(hit, gridX, gridY)))
 			{
-				distance = verticalIntersectionDistance;
-				texture = &graphicsBitmap[12288];
-				textureOffsetX = (verticalIntersectionY >> FRACBITS) & 63;
+				verticalIntersectionX += verticalStepX >> 1;
+				verticalIntersectionY += verticalStepY >> 1;
+				verticalIntersectionDistance = fixedMulFast(verticalIntersectionX - cameraX, viewCos) - fixedMulFast((verticalIntersectionY - cameraY), viewSin);
 				
-				if (verticalIntersectionType == 2)
-				{
-					texture = &graphicsBitmap[4096];
-					textureOffsetX += 64 - verticalDoorOffset;
-				}
+				if (verticalLength + (verticalLengthStep >> 1) + hitMargin < hitLength)
+					hitLength = verticalLength + (verticalLengthStep >> 1) + hitMargin;
 				
-				if (verticalIntersectionType != 2 && rayAngle >= 128 && rayAngle < 384)
-					textureOffsetX = 63 - textureOffsetX;
+				verticalLength = INT32_MAX;
+				continue;
 			}
+			else if (verticalIntersectionType >= 3 && verticalIntersectionType <= 6)
+				SeeSprite(hit, gridX, gridY, verticalIntersectionType);
 			
-			int32_t wallHeight = FindHeight(distance);
-			int32_t wallStart = (64 - wallHeight) >> 1;
+			verticalIntersectionX += verticalStepX;
+			verticalIntersectionY += verticalStepY;
+			verticalLength += verticalLengthStep;
+		}
+	}
+#else
+	if (rayAngle == 0 || rayAngle == 256)
+		horizontalIntersectionDistance = INT_MAX;
+	else
+	{
+		while (1)
+		{
+			int32_t gridX = horizontalIntersectionX >> 22;
+			int32_t gridY = (horizontalIntersectionY >> 22) - (horizontalStepY < 0 ? 1 : 0);
 			
-			if (solidPlanes && wallHeight < 64)
+			if (gridX < 0 || gridY < 0 || gridX >= mapWidth || gridY >= mapHeight)
 			{
-				uint16_t *p = yTable[page][0] + xTable[i];
-				
-				int32_t count = wallStart * 2 - 1;
-				
-				do
-				{
-					*p = 0x00;
-					p += SCREEN_WIDTH >> 1;
-				} while (count--);
+				horizontalIntersectionDistance = INT_MAX;
+				break;
+			}
+			
+#if LIGHTING
+			if (abs(horizontalIntersectionY - cameraY) > ray->fogReachY)
+			{
+				horizontalIntersectionDistance = INT_MAX;
+				break;
 			}
+#endif
 			
-			DrawWallSlice(texture, textureOffsetX, i, wallStart, wallHeight);
+			horizontalIntersectionType = mapData[gridY * mapWidth + gridX];
 			
-			if (solidPlanes && wallHeight < 64)
+			if (horizontalIntersectionType == 1)
 			{
-				uint16_t *p = yTable[page][wallStart + wallHeight] + xTable[i];
-				
-				int32_t count = wallStart * 2 - 1;
-				
-				do
-				{
-					*p = 0x00;
-					p += SCREEN_WIDTH >> 1;
-				} while (count--);
+				horizontalIntersectionDistance = fixedMulFast(horizontalIntersectionX - cameraX, viewCos) - fixedMulFast(horizontalIntersectionY - cameraY, viewSin);
+				break;
 			}
-			else if (wallHeight < 64)
+			else if (horizontalIntersectionType == 2 && (((horizontalIntersectionX + (horizontalStepX >> 1)) >> FRACBITS) & 63) < (horizontalDoorOffset = SeeDoor(hit, gridX, gridY)))
 			{
-				if (i < plane.minX)
-					plane.minX = i;
-				
-				if (i > plane.maxX)
-					plane.maxX = i;
-				
-				plane.top[i] = wallStart + wallHeight;
+				horizontalIntersectionX += horizontalStepX >> 1;
+				horizontalIntersectionY += horizontalStepY >> 1;
+				horizontalIntersectionDistance = fixedMulFast(horizontalIntersectionX - cameraX, viewCos) - fixedMulFast(horizontalIntersectionY - cameraY, viewSin);
+				break;
 			}
+			else if (horizontalIntersectionType >= 3 && horizontalIntersectionType <= 6)
+				SeeSprite(hit, gridX, gridY, horizontalIntersectionType);
 			
-			zBuffer[i] = distance;
-			
-			rayAngle = (rayAngle - 1) & ANGLESMASK;
+			horizontalIntersectionX += horizontalStepX;
+			horizontalIntersectionY += horizontalStepY;
 		}
-		
-		if (!solidPlanes)
+	}
+	
+	if (rayAngle == 128 || rayAngle == 384)
+		verticalIntersectionDistance = INT_MAX;
+	else
+	{
+		while (1)
 		{
-			const uint8_t *floorTexture = &graphicsBitmap[16384];
-			const uint8_t *ceilingTexture = &graphicsBitmap[20480];
-
-			for (int32_t i = 0; i < 32; i++)
-				stop[i] = 0;
+			int32_t gridX = (verticalIntersectionX >> 22) - (verticalStepX < 0 ? 1 : 0);
+			int32_t gridY = verticalIntersectionY >> 22;
 			
-			for (int32_t x = plane.minX; x <= plane.maxX + 1; x++)
+			if (gridX < 0 || gridY < 0 || gridX >= mapWidth || gridY >= mapHeight)
 			{
-				uint32_t t1 = plane.top[x - 1];
-				uint32_t t2 = plane.top[x];
-				
-				while (t1 < t2)
-				{
-					uint32_t index = t1 - 32;
-					
-					if (stop[index] == 0)
-					{
-						fixed_t distance = fixedMul(planeDistanceTable[index], fovInvCos);
-						fixed_t x1 = fixedMul(distance, fixedCos((cameraAngle + 63) & ANGLESMASK));
-						fixed_t y1 = -fixedMul(distance, fixedSin((cameraAngle + 63) & ANGLESMASK));
-						fixed_t x2 = fixedMul(distance, fixedCos((cameraAngle - 64) & ANGLESMASK));
-						fixed_t y2 = -fixedMul(distance, fixedSin((cameraAngle - 64) & ANGLESMASK));
-						currentX[index] = cameraX + x1;
-						currentY[index] = cameraY + y1;
-						stepX[index] = fixedMul(x2 - x1, invViewWidth);
-						stepY[index] = fixedMul(y2 - y1, invViewWidth);
-						currentX[index] += (start[index] + 4) * stepX[index];
-						currentY[index] += (start[index] + 4) * stepY[index];
-					}
-					else
-					{
-						currentX[index] += (start[index] - stop[index]) * stepX[index];
-						currentY[index] += (start[index] - stop[index]) * stepY[index];
-					}
-					
-					uint32_t count = (x - 1) - start[index];
-					uint16_t *p1 = yTable[page][t1] + xTable[start[index]];
-					uint16_t *p2 = yTable[page][63 - t1] + xTable[start[index]];
-					
-					do
-					{
-						int32_t tx = (currentX[index] >> FRACBITS) & 63;
-						int32_t ty = (currentY[index] >> FRACBITS) & 63;
-						int32_t textureIndex = ty * 64 + tx;
-						int32_t color = floorTexture[textureIndex];
-						*p1 = color << 8 | color;
-						*(p1 + (SCREEN_WIDTH >> 1)) = color << 8 | color;
-						p1++;
-						color = ceilingTexture[textureIndex];
-						*p2 = color << 8 | color;
-						*(p2 + (SCREEN_WIDTH >> 1)) = color << 8 | color;
-						p2++;
-						currentX[index] += stepX[index];
-						currentY[index] += stepY[index];
-					} while (count--);
-					
-					stop[index] = x;
-					
-					t1++;
-				}
-				
-				while (t2 < t1)
-				{
-					start[t2 - 32] = x;
-					t2++;
-				}
+				verticalIntersectionDistance = INT_MAX;
+				break;
 			}
-		}
-		
-		for (int32_t i = 0; i < 64; i++)
-		{
-			health_t *health = &healths[i];
 			
-			if (health->render)
+#if LIGHTING
+			if (abs(verticalIntersectionX - cameraX) > ray->fogReachX)
 			{
-				fixed_t distance = fixedMul(((health->gridX << 22) + (32 << FRACBITS)) - cameraX, fixedCos(cameraAngle)) - fixedMul(((health->gridY << 22) + (32 << FRACBITS)) - cameraY, fixedSin(cameraAngle));
-				fixed_t x = fixedMul(((health->gridX << 22) + (32 << FRACBITS)) - cameraX, fixedSin(cameraAngle)) + fixedMul(((health->gridY << 22) + (32 << FRACBITS)) - cameraY, fixedCos(cameraAngle));
-				int32_t spriteSize = FindHeight(distance);
-				x = fixedMul(x, spriteSize << FRACBITS) >> 6;
-				int32_t spriteX = 60 + (x >> FRACBITS) - (spriteSize >> 1);
-				int32_t spriteY = (64 - spriteSize) >> 1;
-				const uint8_t *sprite = &graphicsBitmap[frames[4 + health->type]];
-				DrawSprite(sprite, spriteX, spriteY, spriteSize, distance, 0);
-				health->render = 0;
+				verticalIntersectionDistance = INT_MAX;
+				break;
 			}
-		}
-		
-		for (int32_t i = 0; i < 64; i++)
-		{
-			enemy_t *enemy = &enemies[i];
+#endif
+			
+			verticalIntersectionType = mapData[gridY * mapWidth + gridX];
 			
-			if (enemy->render)
+			if (verticalIntersectionType == 1)
 			{
-				fixed_t distance = fixedMul(((enemy->gridX << 22) + (32 << FRACBITS)) - cameraX, fixedCos(cameraAngle)) - fixedMul(((enemy->gridY << 22) + (32 << FRACBITS)) - cameraY, fixedSin(cameraAngle));
-				fixed_t x = fixedMul(((enemy->gridX << 22) + (32 << FRACBITS)) - cameraX, fixedSin(cameraAngle)) + fixedMul(((enemy->gridY << 22) + (32 << FRACBITS)) - cameraY, fixedCos(cameraAngle));
-				int32_t spriteSize = FindHeight(distance);
-				x = fixedMul(x, spriteSize << FRACBITS) >> 6;
-				int32_t spriteX = 60 + (x >> FRACBITS) - (spriteSize >> 1);
-				int32_t spriteY = (64 - spriteSize) >> 1;
-				const uint8_t *sprite = &graphicsBitmap[frames[enemy->type * 2 + frame]];
-				DrawSprite(sprite, spriteX, spriteY, spriteSize, distance, enemy->damage);
-				enemy->render = 0;
+				verticalIntersectionDistance = fixedMulFast(verticalIntersectionX - cameraX, viewCos) - fixedMulFast((verticalIntersectionY - cameraY), viewSin);
+				break;
 			}
-		}
-		
-		const uint8_t *hand = &graphicsBitmap[49152];
-		
-		if (fireWeaponPressed)
-			DrawGraphic(hand, 25, 0, 95, 38, 25, 26);
-		else
-			DrawGraphic(hand, 0, 0, 95, 38, 25, 26);
-		
-		if (health > 0)
-			DrawRect(28, 60, healthBarTable[health - 1], 2, 0x2A);
-		
-		if (state == 0)
-		{
-			for (uint32_t i = 0; i < 120; i++)
+			else if (verticalIntersectionType == 2 && (((verticalIntersectionY + (verticalStepY >> 1)) >> FRACBITS) & 63) < (verticalDoorOffset = SeeDoor(hit, gridX, gridY)))
 			{
-				if (bloodHeight[i] > 0)
-					DrawRect(i, 0, 1, bloodHeight[i], 0x2A);
+				verticalIntersectionX += verticalStepX >> 1;
+				verticalIntersectionY += verticalStepY >> 1;
+				verticalIntersectionDistance = fixedMulFast(verticalIntersectionX - cameraX, viewCos) - fixedMulFast((verticalIntersectionY - cameraY), viewSin);
+				break;
 			}
+			else if (verticalIntersectionType >= 3 && verticalIntersectionType <= 6)
+				SeeSprite(hit, gridX, gridY, verticalIntersectionType);
+			
+			verticalIntersectionX += verticalStepX;
+			verticalIntersectionY += verticalStepY;
 		}
 	}
-	else if (state == 2)
-	{
-		DrawRect(0, 0, 28, 64, 0x00);
-		const uint8_t *title = &graphicsBitmap[50816];
-		DrawGraphic(title, 0, 0, 28, 0, 64, 64);
-		DrawRect(92, 0, 28, 64, 0x00);
-	}
-	else if (state == 3)
+#endif
+	
+	fixed_t distance;
+	int32_t textureOffsetX;
+	
+	if (horizontalIntersectionDistance < verticalIntersectionDistance)
 	{
-		DrawRect(0, 0, 28, 64, 0x2A);
-		const uint8_t *dead = &graphicsBitmap[54912];
-		DrawGraphic(dead, 0, 0, 28, 0, 64, 64);
-		DrawRect(92, 0, 28, 64, 0x2A);
+		distance = horizontalIntersectionDistance;
+		hit->hitX = horizontalIntersectionX;
+		hit->hitY = horizontalIntersectionY;
+		hit->texture = 0;
+		textureOffsetX = (horizontalIntersectionX >> FRACBITS) & 63;
+		
+		if (horizontalIntersectionType == 2)
+		{
+			hit->texture = 8192;
+			textureOffsetX += 64 - horizontalDoorOffset;
+		}
+		
+		if (horizontalIntersectionType != 2 && rayAngle >= 256)
+			textureOffsetX = 63 - textureOffsetX;
 	}
-	else if (state == 4)
+	else
 	{
-		DrawRect(0, 0, 28, 64, 0x00);
-		const uint8_t *end = &graphicsBitmap[59008];
-		DrawGraphic(end, 0, 0, 28, 0, 64, 64);
-		DrawRect(92, 0, 28, 64, 0x00);
+		distance = verticalIntersectionDistance;
+		hit->hitX = verticalIntersectionX;
+		hit->hitY = verticalIntersectionY;
+		hit->texture = 12288;
+		textureOffsetX = (verticalIntersectionY >> FRACBITS) & 63;
+		
+		if (verticalIntersectionType == 2)
+		{
+			hit->texture = 4096;
+			textureOffsetX += 64 - verticalDoorOffset;
+		}
+		
+		if (verticalIntersectionType != 2 && rayAngle >= 128 && rayAngle < 384)
+			textureOffsetX = 63 - textureOffsetX;
 	}
-	else if (state == 5)
+	
+	hit->textureOffsetX = textureOffsetX;
+	
+	// a ray that leaves the map hits nothing
+	if (distance == INT_MAX)
+		hit->hitX = INT_MAX;
+	
+	return distance;
+}
+
+#if RAY_CACHE
+// The distance of a cached hit along the current view
+static inline __attribute__((always_inline)) fixed_t HitDistance(const rayhit_t *hit, fixed_t viewCos, fixed_t viewSin)
+{
+	if (hit->hitX == INT_MAX)
+		return INT_MAX;
+	
+	return fixedMulFast(hit->hitX - cameraX, viewCos) - fixedMulFast(hit->hitY - cameraY, viewSin);
+}
+
+// Marks the sprites a cached ray passed as tracing it would
+static inline __attribute__((always_inline)) void ReuseSprites(const rayhit_t *hit)
+{
+	for (uint32_t i = 0; i < hit->numSprites; i++)
 	{
-		DrawRect(0, 0, 28, 64, 0x00);
-		const uint8_t *credits = &graphicsBitmap[63104];
-		DrawGraphic(credits, 0, 0, 28, 0, 64, 64);
-		DrawRect(92, 0, 28, 64, 0x00);
+		uint32_t mapIndex = hit->spriteCells[i];
+		MarkSprite(mapIndex, mapData[mapIndex]);
 	}
 }
 
-uint32_t count = 0;
+// The distance of a cached hit along the current view, marking the sprites
+// the ray passed as tracing it would
+static inline __attribute__((always_inline)) fixed_t ReuseRay(const rayhit_t *hit, fixed_t viewCos, fixed_t viewSin)
+{
+	ReuseSprites(hit);
+	return HitDistance(hit, viewCos, viewSin);
+}
 
-void vblankInterrupt()
+// Drops the cached rays that passed through a door cell
+static void InvalidateRayCell(int32_t mapIndex)
 {
-	count++;
+	for (uint32_t i = 0; i < ANGLES; i++)
+	{
+		rayhit_t *hit = &rayCache[i];
+		
+		if (hit->generation != rayGeneration)
+			continue;
+		
+		for (uint32_t j = 0; j < hit->numDoors; j++)
+		{
+			if (hit->doorCells[j] == mapIndex)
+			{
+				hit->generation = 0;
+				break;
+			}
+		}
+	}
 }
 
-int main(void)
+// The cache holds while the camera stays on the same point and the map does
+// not change; a door that moved only drops the rays that went through it
+static void UpdateRayCache()
 {
-	irqInit();
-	irqSet(IRQ_VBLANK, vblankInterrupt);
-	irqEnable(IRQ_VBLANK);
-	
-	REG_IME = 1;
-	
-	SetMode(MODE_4 | BG2_ON);
+	if (cameraX != rayCacheX || cameraY != rayCacheY || mapVersion != rayCacheMapVersion)
+	{
+		rayGeneration++;
+		rayCacheX = cameraX;
+		rayCacheY = cameraY;
+		rayCacheMapVersion = mapVersion;
+		
+		for (uint32_t i = 0; i < doorCount; i++)
+			rayCacheDoorOffsets[i] = doors[i].offset;
+		
+		return;
+	}
+	
+	for (uint32_t i = 0; i < doorCount; i++)
+	{
+		door_t *door = &doors[i];
+		
+		if (door->offset != rayCacheDoorOffsets[i])
+		{
+			InvalidateRayCell(door->mapIndex);
+			rayCacheDoorOffsets[i] = door->offset;
+		}
+	}
+}
+#endif
+
+// Projects this frame's sprite candidates and keeps the ones in front of the
+// camera, on screen and not behind the walls, then sorts them far to near.
+// Past MAX_VISSPRITES a sprite only goes in if it is nearer than the
+// farthest one kept, so a crowd costs a bounded number of draws.
+static void IWRAM_CODE CollectSprites(fixed_t viewCos, fixed_t viewSin)
+{
+	visspriteCount = 0;
+	
+	for (uint32_t i = 0; i < spriteCandidateCount; i++)
+	{
+		uint32_t mapIndex = spriteCandidates[i];
+		uint32_t spriteFrame;
+		uint32_t damage;
+		
+		if (mapData[mapIndex] <= 4)
+		{
+			enemy_t *enemy = &enemies[entityIndex[mapIndex]];
+			spriteFrame = enemy->type * 2 + frame;
+			damage = enemy->damage;
+			enemy->render = 0;
+		}
+		else
+		{
+			health_t *health = &healths[entityIndex[mapIndex]];
+			spriteFrame = 4 + health->type;
+			damage = 0;
+			health->render = 0;
+		}
+		
+		fixed_t dx = (((mapIndex % mapWidth) << 22) + (32 << FRACBITS)) - cameraX;
+		fixed_t dy = (((mapIndex / mapWidth) << 22) + (32 << FRACBITS)) - cameraY;
+		fixed_t distance = fixedMulFast(dx, viewCos) - fixedMulFast(dy, viewSin);
+		
+		if (distance <= 0)
+			continue;
+		
+#if LIGHTING
+		// lost in the fog
+		if (distance >= FOG_DEPTH)
+			continue;
+#endif
+		
+		fixed_t x = fixedMulFast(dx, viewSin) + fixedMulFast(dy, viewCos);
+		int32_t spriteSize = projectHeight(distance);
+		x = fixedMulSat(x, spriteSize << FRACBITS) >> 6;
+		int32_t spriteX = VIEW_WIDTH / 2 + (x >> FRACBITS) - (spriteSize >> 1);
+		
+		if (spriteX + spriteSize <= 0 || spriteX > VIEW_WIDTH - 1)
+			continue;
+		
+		// hidden if it is behind the farthest wall of every run it covers
+		int32_t firstRun = spriteX < 0 ? 0 : spriteX >> 3;
+		int32_t lastRun = spriteX + spriteSize > VIEW_WIDTH ? VIEW_WIDTH / 8 - 1 : (spriteX + spriteSize - 1) >> 3;
+		
+		while (firstRun <= lastRun && distance >= zBufferMax[firstRun])
+			firstRun++;
+		
+		if (firstRun > lastRun)
+			continue;
+		
+		vissprite_t *vis;
+		
+		if (visspriteCount < MAX_VISSPRITES)
+			vis = &vissprites[visspriteCount++];
+		else
+		{
+			vis = &vissprites[0];
+			
+			for (uint32_t j = 1; j < MAX_VISSPRITES; j++)
+			{
+				if (vissprites[j].distance > vis->distance)
+					vis = &vissprites[j];
+			}
+			
+			if (distance >= vis->distance)
+				continue;
+		}
+		
+		vis->distance = distance;
+		vis->spriteFrame = spriteFrame;
+		vis->spriteX = spriteX;
+		vis->spriteSize = spriteSize;
+		vis->damage = damage;
+	}
+	
+	spriteCandidateCount = 0;
+	
+	// insertion sort, the list is short
+	for (uint32_t i = 1; i < visspriteCount; i++)
+	{
+		vissprite_t vis = vissprites[i];
+		int32_t j = i - 1;
+		
+		while (j >= 0 && vissprites[j].distance < vis.distance)
+		{
+			vissprites[j + 1] = vissprites[j];
+			j--;
+		}
+		
+		vissprites[j + 1] = vis;
+	}
+}
+
+// Renders columns view columns from the next frame on, see columnWidth: half
+// of them are all 2 wide and two thirds are 2, 1, 2, 1 and so on
+void SetResolution(uint32_t columns)
+{
+	for (uint32_t i = 0; i < VIEW_WIDTH; i += columnWidth[i])
+		columnWidth[i] = columns == resolutionSteps[2] || (columns == resolutionSteps[1] && i % 3 == 0 && i + 1 < VIEW_WIDTH) ? 2 : 1;
+	
+	renderColumns = columns;
+	interlaceValid = 0;
+}
+
+// Picks the resolution of the next frame from what the last one cost in
+// cycles, Update() and Render() together
+void ResolutionUpdate(uint32_t cycles)
+{
+	uint32_t step = resolutionStep;
+	
+	if (cycles > RESOLUTION_DROP)
+	{
+		resolutionCalm = 0;
+		
+		if (step < 2)
+		{
+			step++;
+			resolutionDrops++;
+		}
+	}
+	else if (cycles < RESOLUTION_RESTORE && step > 0)
+	{
+		if (++resolutionCalm == RESOLUTION_HOLD)
+		{
+			resolutionCalm = 0;
+			step--;
+		}
+	}
+	else
+		resolutionCalm = 0;
+	
+	if (step != resolutionStep)
+	{
+		resolutionStep = step;
+		SetResolution(resolutionSteps[step]);
+#if RESOLUTION_LOG
+		DebugLog("resolution: %lu columns after %lu cycles, %lu drops", (unsigned long) renderColumns, (unsigned long) cycles, (unsigned long) resolutionDrops);
+#endif
+	}
+}
+
+// Draws a 64x64 screen graphic in the middle of the view, filling the border
+// around it with one colour. The screens have no colour key texels, so none
+// of them are keyed.
+static inline __attribute__((always_inline)) void DrawScreen(const uint8_t *graphic, uint8_t color)
+{
+	int32_t x = (VIEW_WIDTH - 64) >> 1;
+	int32_t y = (VIEW_HEIGHT - 64) >> 1;
+	
+	if (x > 0)
+		FillViewRect(0, 0, x, VIEW_HEIGHT, color);
+	
+	if (y > 0)
+	{
+		FillViewRect(x, 0, 64, y, color);
+		FillViewRect(x, y + 64, 64, VIEW_HEIGHT - 64 - y, color);
+	}
+	
+	RECORD_KERNEL(KERNEL_GRAPHIC, 0, graphic, 0, 0, x, y, 64, 64);
+	DrawGraphicOpaque(graphic, 0, 0, x, y, 64, 64);
+	
+	if (x > 0)
+		FillViewRect(x + 64, 0, VIEW_WIDTH - 64 - x, VIEW_HEIGHT, color);
+}
+
+// Copies the rendered column of width view columns at x from the last
+// frame's page, where the last frame drew it shift columns to the left, and
+// sets its depth and plane rows. The last frame has to have traced all of
+// them with the same ray, and with no sprite drawn over them, or nothing is
+// copied and 0 returned so the column is traced instead.
+//
+// With RAY_CACHE the ray has to be cached still, so no door it passed has
+// moved, and has to project to the same wall height (and light table) as it
+// did then, so the copy is exactly what tracing the column would draw. Its
+// sprites are marked as tracing it would. Without the cache nothing is
+// copied once the camera turned, so the ray is the same one and so is the
+// wall it hits.
+static inline __attribute__((always_inline)) uint32_t CopyColumns(int32_t x, int32_t width, int32_t shift, angle_t rayAngle, fixed_t viewCos, fixed_t viewSin)
+{
+	int32_t source = x - shift;
+	
+	if (source < 0 || source + width > VIEW_WIDTH)
+		return 0;
+	
+	for (int32_t j = 0; j < width; j++)
+	{
+		if (interlaceRay[source + j] != rayAngle)
+			return 0;
+	}
+	
+	fixed_t lastDistance = interlaceDepth[source];
+	
+#if RAY_CACHE
+	const rayhit_t *hit = &rayCache[rayAngle];
+	fixed_t distance = HitDistance(hit, viewCos, viewSin);
+	
+#if LIGHTING
+	if (distance >= FOG_DEPTH)
+		distance = FOG_DEPTH;
+	
+	if (LightTable(distance) != LightTable(lastDistance))
+		return 0;
+#endif
+	
+	int32_t wallHeight = projectHeight(distance);
+	
+	if (wallHeight != projectHeight(lastDistance))
+		return 0;
+	
+	ReuseSprites(hit);
+#else
+	fixed_t distance = lastDistance;
+	int32_t wallHeight = projectHeight(distance);
+#endif
+	
+	int32_t wallStart = (VIEW_HEIGHT - wallHeight) >> 1;
+	int32_t y = wallStart < 0 ? 0 : wallStart;
+	
+	for (int32_t j = 0; j < width; j++)
+	{
+		int32_t count = (wallHeight < VIEW_HEIGHT ? wallHeight : VIEW_HEIGHT) - 1;
+		const uint16_t *src = yTable[interlacePage][y] + xTable[source + j];
+		uint16_t *dst = yTable[page][y] + xTable[x + j];
+		
+		do
+		{
+			PUT_PIXEL(dst, *src);
+			src += VIEW_STRIDE;
+			dst += VIEW_STRIDE;
+		} while (count--);
+		
+		if (wallHeight < VIEW_HEIGHT)
+		{
+			if (x + j < plane.minX)
+				plane.minX = x + j;
+			
+			if (x + j > plane.maxX)
+				plane.maxX = x + j;
+			
+			plane.top[x + j] = wallStart + wallHeight;
+		}
+		
+		zBuffer[x + j] = distance;
+		columnRay[x + j] = NO_RAY;
+	}
+	
+	interlaceCopies += width;
+	return 1;
+}
+
+void IWRAM_CODE ARM_CODE Render()
+{
+	int32_t barWidth = health > 0 ? healthBarTable[health - 1] : 0;
+	
+	// the blood wipe covers the hand and health bar, so while it runs they
+	// are drawn into the page instead of shown as OBJs
+	HudUpdate(state == 1, fireWeaponPressed, barWidth);
+	
+	if (state == 1 || state == 0)
+	{
+		plane.minX = VIEW_WIDTH;
+		plane.maxX = -1;
+		
+		plane.pad1 = VIEW_HEIGHT;
+		
+		for (int32_t i = 0; i < VIEW_WIDTH; i++)
+			plane.top[i] = VIEW_HEIGHT;
+		
+		plane.pad2 = VIEW_HEIGHT;
+		
+		fixed_t viewCos = fixedCos(cameraAngle);
+		fixed_t viewSin = fixedSin(cameraAngle);
+		fixed_t cellX = (cameraX >> 22) * (64 << FRACBITS);
+		fixed_t cellY = (cameraY >> 22) * (64 << FRACBITS);
+		
+#if RAY_CACHE
+		UpdateRayCache();
+#endif
+		
+		// Interlaced, the first pass traces the rendered columns of one
+		// parity and the second copies the others from the last frame
+		// where it can. The parity alternates in view angle, so when the
+		// camera turned an odd number of columns the copies still come from
+		// columns the last frame traced. Once the camera has moved or the
+		// map changed every wall may have, so nothing is copied.
+		uint32_t interlaced = interlaceColumns && interlaceValid && state == 1 && interlaceMapVersion == mapVersion && cameraX == interlaceX && cameraY == interlaceY;
+		
+#if !RAY_CACHE
+		// without the ray cache nothing tells which columns a door is in or
+		// where a column's wall is once the camera turned, so none is
+		// copied after a turn or while a door moves or just after it stopped
+		uint32_t doorsMoving = 0;
+		
+		for (uint32_t i = 0; i < doorCount; i++)
+			doorsMoving |= doors[i].state == 1 || doors[i].state == 3;
+		
+		interlaced = interlaced && cameraAngle == interlaceAngle && !doorsMoving && !interlaceDoorsMoving;
+		interlaceDoorsMoving = doorsMoving;
+#endif
+		int32_t shift = 0;
+		uint32_t parity = 0;
+		
+		if (interlaced)
+		{
+			shift = ((int32_t) ((cameraAngle - interlaceAngle + (ANGLES >> 1)) & ANGLESMASK) - (ANGLES >> 1)) * (VIEW_FOCAL / 64);
+			parity = interlaceParity ^ 1 ^ (shift & 1);
+#if RAY_CACHE
+			// a ray dropped from the cache since may be traced again by a
+			// column of this frame's parity that shares it before the other
+			// is copied, so its columns are marked as not copyable first
+			for (int32_t i = 0; i < VIEW_WIDTH; i++)
+				interlaceRay[i] = columnRay[i] != NO_RAY && rayCache[columnRay[i]].generation == rayGeneration ? columnRay[i] : NO_RAY;
+#else
+			memcpy(interlaceRay, columnRay, sizeof(columnRay));
+#endif
+			memcpy(interlaceDepth, zBuffer, sizeof(interlaceDepth));
+		}
+		
+		for (uint32_t pass = 0; pass <= interlaced; pass++)
+		{
+			for (int32_t i = 0, k = 0, width; i < VIEW_WIDTH; i += width, k++)
+			{
+				width = columnWidth[i];
+				
+				if (interlaced && ((k & 1) == parity) == pass)
+					continue;
+				
+				angle_t rayAngle = (cameraAngle + columnAngleTable[i]) & ANGLESMASK;
+				
+				if (pass && CopyColumns(i, width, shift, rayAngle, viewCos, viewSin))
+					continue;
+				
+				fixed_t distance;
+#if RAY_CACHE
+				rayhit_t *hit = &rayCache[rayAngle];
+				
+				if (hit->generation == rayGeneration)
+					distance = ReuseRay(hit, viewCos, viewSin);
+				else
+				{
+					hit->numDoors = 0;
+					hit->numSprites = 0;
+					distance = TraceRay(hit, rayAngle, viewCos, viewSin, cellX, cellY);
+					
+					// a ray that passed more cells than it can keep is traced again
+					if (hit->numDoors <= RAY_CACHE_CELLS && hit->numSprites <= RAY_CACHE_CELLS)
+						hit->generation = rayGeneration;
+				}
+#else
+				rayhit_t traced;
+				rayhit_t *hit = &traced;
+				distance = TraceRay(hit, rayAngle, viewCos, viewSin, cellX, cellY);
+#endif
+				
+				const uint8_t *texture = &graphicsBitmap[hit->texture];
+				int32_t textureOffsetX = hit->textureOffsetX;
+				
+				uint32_t fogged = 0;
+				
+#if LIGHTING
+				// a wall in the fog, or a ray the fog stopped, is filled with
+				// the fog colour as a wall at the fog's distance
+				if (distance >= FOG_DEPTH)
+				{
+					distance = FOG_DEPTH;
+					fogged = 1;
+				}
+				
+				lightTable = LightTable(distance);
+#endif
+				
+				int32_t wallHeight = projectHeight(distance);
+				int32_t wallStart = (VIEW_HEIGHT - wallHeight) >> 1;
+				
+				if (fogged)
+				{
+					for (int32_t j = i; j < i + width; j++)
+						FillColumn(j, wallStart, wallHeight, PIXEL(FOG_COLOR));
+				}
+				else
+				{
+					RECORD_KERNEL(KERNEL_WALL_SLICE, (width - 1) << 1 | (wallHeight > VIEW_HEIGHT), texture, textureOffsetX, i, wallStart, wallHeight, 0, 0);
+					
+					if (width == 2)
+					{
+						if (wallHeight > VIEW_HEIGHT)
+							DrawWallSliceClipWide(texture, textureOffsetX, i, wallStart, wallHeight);
+						else
+							DrawWallSliceFitWide(texture, textureOffsetX, i, wallStart, wallHeight);
+					}
+					else if (wallHeight > VIEW_HEIGHT)
+						DrawWallSliceClip(texture, textureOffsetX, i, wallStart, wallHeight);
+					else
+						DrawWallSliceFit(texture, textureOffsetX, i, wallStart, wallHeight);
+				}
+				
+				for (int32_t j = i; j < i + width; j++)
+				{
+					if (wallHeight < VIEW_HEIGHT)
+					{
+						if (j < plane.minX)
+							plane.minX = j;
+						
+						if (j > plane.maxX)
+							plane.maxX = j;
+						
+						plane.top[j] = wallStart + wallHeight;
+					}
+					
+					zBuffer[j] = distance;
+					columnRay[j] = rayAngle;
+				}
+			}
+		}
+		
+		interlaceParity = parity;
+		
+		for (int32_t i = 0; i < VIEW_WIDTH / 8; i++)
+		{
+			fixed_t farthest = zBuffer[i * 8];
+			
+			for (int32_t j = 1; j < 8; j++)
+			{
+				if (zBuffer[i * 8 + j] > farthest)
+					farthest = zBuffer[i * 8 + j];
+			}
+			
+			zBufferMax[i] = farthest;
+		}
+		
+		PROFILE_MARK(PROFILE_RAYS);
+		
+		if (solidPlanes)
+		{
+			// The ceiling and floor rows above and below every wall are
+			// filled whole, the rest of each column on its own. Walls are
+			// an even number of rows, so a column's ceiling and floor are
+			// as tall as each other.
+			uint32_t floorTop = 0;
+			
+			for (int32_t i = 0; i < VIEW_WIDTH; i++)
+			{
+				if (plane.top[i] > floorTop)
+					floorTop = plane.top[i];
+			}
+			
+			int32_t rows = VIEW_HEIGHT - floorTop;
+			
+			if (rows > 0)
+			{
+				FillViewRect(0, 0, VIEW_WIDTH, rows, 0x00);
+				FillViewRect(0, VIEW_HEIGHT - rows, VIEW_WIDTH, rows, 0x00);
+			}
+			
+			for (int32_t i = plane.minX; i <= plane.maxX; i++)
+			{
+				int32_t wallStart = VIEW_HEIGHT - plane.top[i];
+				
+				if (wallStart > rows)
+				{
+					FillColumn(i, rows, wallStart - rows, PIXEL(0x00));
+					FillColumn(i, plane.top[i], wallStart - rows, PIXEL(0x00));
+				}
+			}
+		}
+		else
+		{
+			fixed_t leftCos = fixedCos((cameraAngle + 63) & ANGLESMASK);
+			fixed_t leftSin = fixedSin((cameraAngle + 63) & ANGLESMASK);
+			fixed_t rightCos = fixedCos((cameraAngle - 64) & ANGLESMASK);
+			fixed_t rightSin = fixedSin((cameraAngle - 64) & ANGLESMASK);
+			
+			// the rays at the view's edges span VIEW_FOCAL columns either
+			// side of the centre, and the view starts VIEW_FOCAL -
+			// VIEW_WIDTH / 2 columns in
+			for (int32_t i = 0; i < VIEW_HEIGHT / 2; i++)
+			{
+				fixed_t distance = fixedMulFast(planeDistanceTable[i], fovInvCos);
+				fixed_t x1 = fixedMulFast(distance, leftCos);
+				fixed_t y1 = -fixedMulFast(distance, leftSin);
+				fixed_t x2 = fixedMulFast(distance, rightCos);
+				fixed_t y2 = -fixedMulFast(distance, rightSin);
+				stepX[i] = fixedMulFast(x2 - x1, invViewWidth);
+				stepY[i] = fixedMulFast(y2 - y1, invViewWidth);
+				rowX[i] = cameraX + x1 + (VIEW_FOCAL - VIEW_WIDTH / 2) * stepX[i];
+				rowY[i] = cameraY + y1 + (VIEW_FOCAL - VIEW_WIDTH / 2) * stepY[i];
+			}
+			
+			for (int32_t x = plane.minX; x <= plane.maxX + 1; x++)
+			{
+				uint32_t t1 = plane.top[x - 1];
+				uint32_t t2 = plane.top[x];
+				
+				while (t1 < t2)
+				{
+					uint32_t index = t1 - VIEW_HEIGHT / 2;
+					uint32_t count = (x - 1) - start[index];
+					uint16_t *p1 = yTable[page][t1] + xTable[start[index]];
+					uint16_t *p2 = yTable[page][VIEW_HEIGHT - 1 - t1] + xTable[start[index]];
+					fixed_t spanX = rowX[index] + start[index] * stepX[index];
+					fixed_t spanY = rowY[index] + start[index] * stepY[index];
+					
+#if LIGHTING
+					lightTable = rowLightTables[index];
+#endif
+					DrawPlaneSpan(p1, p2, planeTexture, spanX, spanY, stepX[index], stepY[index], count);
+					
+					t1++;
+				}
+				
+				while (t2 < t1)
+				{
+					start[t2 - VIEW_HEIGHT / 2] = x;
+					t2++;
+				}
+			}
+		}
+		
+		PROFILE_MARK(PROFILE_PLANES);
+		
+		CollectSprites(viewCos, viewSin);
+		
+		for (uint32_t i = 0; i < visspriteCount; i++)
+		{
+			vissprite_t *vis = &vissprites[i];
+			uint32_t clipped = vis->spriteX < 0 || vis->spriteX + vis->spriteSize > VIEW_WIDTH || vis->spriteSize > VIEW_HEIGHT;
+			uint32_t damage = vis->damage != 0;
+			int32_t spriteY = (VIEW_HEIGHT - vis->spriteSize) >> 1;
+			
+			RECORD_KERNEL(KERNEL_SPRITE, clipped << 1 | damage, NULL, vis->spriteFrame, vis->spriteX, spriteY, vis->spriteSize, vis->distance, 0);
+#if LIGHTING
+			lightTable = LightTable(vis->distance);
+#endif
+			spriteKernels[clipped][damage](vis->spriteFrame, vis->spriteX, spriteY, vis->spriteSize, vis->distance);
+			
+			// the next frame traces the columns a sprite may have drawn
+			// over rather than copy them
+			if (interlaceColumns)
+			{
+				int32_t first = vis->spriteX < 0 ? 0 : vis->spriteX;
+				int32_t last = vis->spriteX + vis->spriteSize > VIEW_WIDTH ? VIEW_WIDTH : vis->spriteX + vis->spriteSize;
+				
+				for (int32_t j = first; j < last; j++)
+					columnRay[j] = NO_RAY;
+			}
+		}
+		
+		PROFILE_MARK(PROFILE_SPRITES);
+		
+		if (state == 0)
+		{
+			const uint8_t *hand = &graphicsBitmap[HUD_HAND];
+			
+			int32_t handX = fireWeaponPressed ? HUD_HAND_WIDTH : 0;
+			
+#if HUD_HAND_SCALE > 1
+			DrawGraphicScaled(hand, handX, 0, HUD_HAND_X, HUD_HAND_Y, HUD_HAND_WIDTH, HUD_HAND_HEIGHT);
+#else
+			RECORD_KERNEL(KERNEL_GRAPHIC, 1, hand, handX, 0, HUD_HAND_X, HUD_HAND_Y, HUD_HAND_WIDTH, HUD_HAND_HEIGHT);
+			DrawGraphicKeyed(hand, handX, 0, HUD_HAND_X, HUD_HAND_Y, HUD_HAND_WIDTH, HUD_HAND_HEIGHT);
+#endif
+			
+			if (barWidth > 0)
+				FillViewRect(HUD_BAR_X, HUD_BAR_Y, barWidth, 2, 0x2A);
+			
+			// the rows every column's blood has reached are filled whole
+			uint32_t bloodRows = VIEW_HEIGHT;
+			
+			for (uint32_t i = 0; i < VIEW_WIDTH; i++)
+			{
+				if (bloodHeight[i] < bloodRows)
+					bloodRows = bloodHeight[i];
+			}
+			
+			if (bloodRows > 0)
+				FillViewRect(0, 0, VIEW_WIDTH, bloodRows, 0x2A);
+			
+			for (uint32_t i = 0; i < VIEW_WIDTH; i++)
+			{
+				if (bloodHeight[i] > bloodRows)
+					FillColumn(i, bloodRows, bloodHeight[i] - bloodRows, PIXEL(0x2A));
+			}
+		}
+	}
+	else if (state == 2)
+		DrawScreen(&graphicsBitmap[50816], 0x00);
+	else if (state == 3)
+		DrawScreen(&graphicsBitmap[54912], 0x2A);
+	else if (state == 4)
+		DrawScreen(&graphicsBitmap[59008], 0x00);
+	else if (state == 5)
+		DrawScreen(&graphicsBitmap[63104], 0x00);
+	
+	// only a game frame can be copied from
+	interlaceValid = interlaceColumns && state == 1;
+	interlacePage = page;
+	interlaceAngle = cameraAngle;
+	interlaceX = cameraX;
+	interlaceY = cameraY;
+	interlaceMapVersion = mapVersion;
+	
+	// the HUD, or the whole screen outside of the game
+	PROFILE_MARK(PROFILE_HUD);
+}
+
+void InitRayTables()
+{
+	for (angle_t a = 0; a < ANGLES; a++)
+	{
+		ray_t *ray = &rayTable[a];
+		
+		ray->cot = fixedCot(a);
+		ray->tan = fixedTan(a);
+		ray->horizontalEdgeY = a < 256 ? 0 : 64 << FRACBITS;
+		ray->horizontalStepY = a < 256 ? -64 << FRACBITS : 64 << FRACBITS;
+		ray->horizontalStepX = -fixedMul(ray->horizontalStepY, ray->cot);
+		ray->verticalEdgeX = a >= 128 && a < 384 ? 0 : 64 << FRACBITS;
+		ray->verticalStepX = a >= 128 && a < 384 ? -64 << FRACBITS : 64 << FRACBITS;
+		ray->verticalStepY = -fixedMul(ray->verticalStepX, ray->tan);
+		ray->absSin = abs(fixedSin(a));
+		ray->absCos = abs(fixedCos(a));
+		// in the quarter map units times |sin| * |cos| of TraceRay's lengths
+		ray->hitMargin = ((DDA_HIT_MARGIN * 4) * (int64_t) ray->absSin * ray->absCos) >> 16;
+#if LIGHTING
+		// every column looks less than the 45 degrees of fovInvCos off the
+		// view, so nothing nearer than the fog along it is farther away
+		fixed_t fogRadius = fixedMul(FOG_DEPTH, fovInvCos);
+		ray->fogLength = ((fogRadius >> 14) * (int64_t) ray->absSin * ray->absCos) >> 16;
+		ray->fogReachX = fixedMul(fogRadius, ray->absCos);
+		ray->fogReachY = fixedMul(fogRadius, ray->absSin);
+#endif
+	}
+}
+
+// The tables that depend on the view size, see view.h
+void InitViewTables()
+{
+	for (int32_t i = 0; i < VIEW_WIDTH; i++)
+	{
+		int32_t offset = VIEW_WIDTH / 2 - 1 - i;
+#if CORRECTED_COLUMNS
+		// Sprites and planes are projected VIEW_FOCAL columns per unit of
+		// tangent, so column i looks along atan(offset / VIEW_FOCAL), snapped
+		// to the nearest angle
+		fixed_t target = abs(offset) << (FRACBITS - 6 - PROJECTION_SHIFT);
+		int32_t best = 0;
+		
+		for (int32_t a = 1; a < 128; a++)
+		{
+			if (abs(fixedTan(a) - target) < abs(fixedTan(best) - target))
+				best = a;
+		}
+		
+		columnAngleTable[i] = offset < 0 ? -best : best;
+#else
+		columnAngleTable[i] = offset >> PROJECTION_SHIFT;
+#endif
+	}
+	
+	// row i below the horizon is the floor VIEW_FOCAL (i + 1/2) / 32 units
+	// under the eye, so its distance is 32 VIEW_FOCAL / (i + 1/2) units
+	for (int32_t i = 0; i < VIEW_HEIGHT / 2; i++)
+		planeDistanceTable[i] = (VIEW_FOCAL << (FRACBITS + 6)) / (2 * i + 1);
+	
+#if LIGHTING
+	for (int32_t i = 0; i < VIEW_HEIGHT / 2; i++)
+		rowLightTables[i] = LightTable(planeDistanceTable[i]);
+#endif
+	
+	for (int32_t i = 0; i < 100; i++)
+		healthBarTable[i] = i * HUD_BAR_WIDTH / 100;
+}
+
+void Init()
+{
+	uint16_t *vid_mem_front = (uint16_t *) (VRAM);
+	uint16_t *vid_mem_back = (uint16_t *) (VRAM | 0xA000);
 	
 	//BG_COLORS[1] = RGB8(255, 0, 0);
 	//BG_COLORS[2] = RGB8(0, 255, 0);
 	//BG_COLORS[3] = RGB8(0, 0, 255);
 	
-	memcpy(BG_COLORS, graphicsPal, graphicsPalLen);
+	BlitCopy(BG_COLORS, graphicsPal, graphicsPalLen >> 1);
 	
-	uint16_t *vid_mem_front = (uint16_t *) (VRAM);
-	uint16_t *vid_mem_back = (uint16_t *) (VRAM | 0xA000);
+#if COMPACT_FRAMEBUFFER
+	SetMode(MODE_5 | BG2_ON | OBJ_ON | OBJ_1D_MAP);
+	
+	// 1 / VIEW_SCALE bitmap pixels per screen pixel, and the view's top left
+	// texel on screen at VIEW_SCREEN_X, VIEW_SCREEN_Y as in mode 4
+	REG_BG2PA = (1 << 8) / VIEW_SCALE;
+	REG_BG2PB = 0;
+	REG_BG2PC = 0;
+	REG_BG2PD = (1 << 8) / VIEW_SCALE;
+	REG_BG2X = -((VIEW_SCREEN_X << 8) / VIEW_SCALE);
+	REG_BG2Y = -((VIEW_SCREEN_Y << 8) / VIEW_SCALE);
+	
+#if TRIPLE_BUFFER
+	// page 2 leaves other rows of the bitmap under and over the view on
+	// screen, so window 0 only shows BG2 in the view's rectangle
+	REG_DISPCNT |= WIN0_ON;
+	REG_WIN0H = VIEW_SCREEN_X << 8 | (VIEW_SCREEN_X + VIEW_WIDTH * VIEW_SCALE);
+	REG_WIN0V = VIEW_SCREEN_Y << 8 | (VIEW_SCREEN_Y + VIEW_HEIGHT * VIEW_SCALE);
+	REG_WININ = BIT(2) | BIT(4);
+	REG_WINOUT = BIT(4);
+#endif
+	
+	memcpy(colorTable, graphicsPal, sizeof(colorTable));
+	
+	for (uint32_t p = 0; p < PAGES; p++)
+	{
+		uint16_t *vid_mem = PAGE_BITMAP(p) ? vid_mem_back : vid_mem_front;
+		
+		for (uint32_t i = 0; i < VIEW_HEIGHT; i++)
+			yTable[p][i] = &vid_mem[(PAGE_ROW(p) + i) * ROW_STRIDE];
+	}
+	
+	for (uint32_t i = 0; i < VIEW_WIDTH; i++)
+		xTable[i] = i;
+#else
+	SetMode(MODE_4 | BG2_ON | OBJ_ON | OBJ_1D_MAP);
+	
+	for (uint32_t i = 0; i < VIEW_HEIGHT; i++)
+	{
+		yTable[0][i] = (uint16_t *) &vid_mem_front[(VIEW_SCREEN_Y + 2 * i) * (SCREEN_WIDTH >> 1)];
+		yTable[1][i] = (uint16_t *) &vid_mem_back[(VIEW_SCREEN_Y + 2 * i) * (SCREEN_WIDTH >> 1)];
+	}
+	
+	for (uint32_t i = 0; i < VIEW_WIDTH; i++)
+		xTable[i] = (VIEW_SCREEN_X >> 1) + i;
+#endif
+	
+	InitRayTables();
+	InitViewTables();
+#if LIGHTING
+	LightInit();
+#endif
+	HudInit();
+	SetResolution(VIEW_WIDTH);
+	
+	for (uint32_t i = 0; i < 4096; i++)
+		planeTexture[i] = PLANE_TEXEL(graphicsBitmap[16384 + i], graphicsBitmap[20480 + i]);
+}
+
+// Shows page p: picks its bitmap page and, with three pages, scrolls BG2 to
+// its rows
+void ShowPage(uint32_t p)
+{
+	if (PAGE_BITMAP(p))
+		REG_DISPCNT |= BACKBUFFER;
+	else
+		REG_DISPCNT &= ~BACKBUFFER;
+	
+#if TRIPLE_BUFFER
+	REG_BG2Y = -((VIEW_SCREEN_Y << 8) / VIEW_SCALE) + (PAGE_ROW(p) << 8);
+#endif
+	
+	shownPage = p;
+}
+
+// Shows the page just drawn with its HUD and moves on to the next one, for
+// the loops that flip at once: the timedemo, the host builds and, with two
+// pages, main()
+void FlipPage()
+{
+	ShowPage(page);
+	HudCommit();
+	page = page + 1 < PAGES ? page + 1 : 0;
+}
+
+#ifndef HOST
+
+#if KERNEL_BENCH
+#include <gba_timers.h>
+
+// Cycle counter from timer 2 with timer 3 cascaded on top of it
+void StartTimer()
+{
+	REG_TM2CNT_H = 0;
+	REG_TM3CNT_H = 0;
+	REG_TM2CNT_L = 0;
+	REG_TM3CNT_L = 0;
+	REG_TM3CNT_H = TIMER_START | TIMER_COUNT;
+	REG_TM2CNT_H = TIMER_START;
+}
+
+uint32_t StopTimer()
+{
+	REG_TM2CNT_H = 0;
+	return REG_TM3CNT_L << 16 | REG_TM2CNT_L;
+}
+
+// Times the C and ARM kernels on the back page and prints cycles per pixel to
+// the mGBA log, see debug.h
+void BenchKernels()
+{
+	uint32_t i, j, cycles[2];
+	uint16_t *p = (uint16_t *)(VRAM | 0xA000);
+	const uint8_t *texture = (const uint8_t *)graphicsBitmap;
+	static const uint32_t heights[4] = { 8, 32, 64, 256 };
+	static const uint32_t spans[3] = { 8, 40, 120 };
+	
+	for (i = 0; i < 4; i++)
+	{
+		uint32_t count = heights[i] < 128 ? heights[i] >> 1 : 64;
+		fixed_t scalar = scalarTable[(MAX_HEIGHT - heights[i]) >> 1];
+		
+		StartTimer();
+		for (j = 0; j < 120; j++)
+			DrawWallColumnC(p + j, texture, 0, scalar, count - 1);
+		cycles[0] = StopTimer();
+		StartTimer();
+		for (j = 0; j < 120; j++)
+			DrawWallColumnArm(p + j, texture, 0, scalar, count - 1);
+		cycles[1] = StopTimer();
+		DebugLog("wall height %lu: C %lu, ARM %lu cycles/texel", heights[i], cycles[0] / (120 * count), cycles[1] / (120 * count));
+	}
+	
+	for (i = 0; i < 3; i++)
+	{
+		StartTimer();
+		for (j = 0; j < 32; j++)
+			DrawPlaneSpanC(p + j * SCREEN_WIDTH, p + (63 - j) * SCREEN_WIDTH, planeTexture, j << 16, j << 15, 0x9000, -0x3000, spans[i] - 1);
+		cycles[0] = StopTimer();
+		StartTimer();
+		for (j = 0; j < 32; j++)
+			DrawPlaneSpanArm(p + j * SCREEN_WIDTH, p + (63 - j) * SCREEN_WIDTH, planeTexture, j << 16, j << 15, 0x9000, -0x3000, spans[i] - 1);
+		cycles[1] = StopTimer();
+		DebugLog("plane span %lu: C %lu, ARM %lu cycles/pixel", spans[i], cycles[0] / (32 * spans[i]), cycles[1] / (32 * spans[i]));
+	}
+	
+	// the whole rows of the blood wipe and solid planes, the health bar and
+	// a screen's borders
+	static const uint8_t rects[4][4] =
+	{
+		{ 0, 0, VIEW_WIDTH, VIEW_HEIGHT / 2 },
+		{ 0, 0, VIEW_WIDTH, VIEW_HEIGHT / 4 },
+		{ HUD_BAR_X, HUD_BAR_Y, HUD_BAR_WIDTH, 2 },
+		{ 0, 0, (VIEW_WIDTH - 64) >> 1, VIEW_HEIGHT }
+	};
+	
+	for (i = 0; i < 4; i++)
+	{
+		const uint8_t *r = rects[i];
+		
+		StartTimer();
+		DrawRect(r[0], r[1], r[2], r[3], 0x2A);
+		cycles[0] = StopTimer();
+		StartTimer();
+		FillRect(r[0], r[1], r[2], r[3], 0x2A);
+		cycles[1] = StopTimer();
+		DebugLog("rect %lux%lu: DrawRect %lu, FillRect %lu cycles", (unsigned long) r[2], (unsigned long) r[3], cycles[0], cycles[1]);
+	}
+}
+#endif
+
+// The game runs at a fixed 60 ticks a second, one Update() per VBlank counted
+// by vblankInterrupt. A frame that takes longer than a VBlank to render runs
+// the ticks it missed before the next Render(), but never more than MAX_TICKS
+// of them, so a slow room cannot make every following frame slower still.
+#define MAX_TICKS 4
+
+// The profiler overlay's 8 rows go in the border under the view, or over its
+// top rows when the view leaves no room there or page 2 is under it
+#if !TRIPLE_BUFFER && VIEW_SCREEN_Y >= 8 * VIEW_SCALE && VIEW_HEIGHT + 8 <= PAGE_ROWS
+#define PROFILE_OVERLAY_ROW VIEW_HEIGHT
+#else
+#define PROFILE_OVERLAY_ROW 0
+#endif
+
+volatile uint32_t count = 0;
+uint32_t ticks = 0;
+
+#if TRIPLE_BUFFER
+// The page waiting for the next VBlank, or NO_PAGE
+#define NO_PAGE PAGES
+
+volatile uint32_t queuedPage = NO_PAGE;
+#endif
+
+void vblankInterrupt()
+{
+	count++;
 	
-	for (uint32_t i = 0; i < 64; i++)
+#if TRIPLE_BUFFER
+	if (queuedPage != NO_PAGE)
 	{
-		yTable[0][i] = (uint16_t *) &vid_mem_front[(((SCREEN_HEIGHT - 128) >> 1) + 2 * i) * (SCREEN_WIDTH >> 1)];
-		yTable[1][i] = (uint16_t *) &vid_mem_back[(((SCREEN_HEIGHT - 128) >> 1) + 2 * i) * (SCREEN_WIDTH >> 1)];
+		ShowPage(queuedPage);
+		HudCommitQueued();
+		queuedPage = NO_PAGE;
 	}
+#endif
+}
+
+int main(void)
+{
+	irqInit();
+	irqSet(IRQ_VBLANK, vblankInterrupt);
+	irqEnable(IRQ_VBLANK);
+	
+	REG_IME = 1;
+	
+	SeedRandom((unsigned)time(NULL));
+	
+	Init();
+	
+#if TIMEDEMO
+	ProfileStartClock();
+	Timedemo();
+	
+	level = 1;
+	state = 2;
+#endif
 	
-	for (uint32_t i = 0; i < 120; i++)
-		xTable[i] = (((SCREEN_WIDTH >> 1) - 120) >> 1) + i;
+#if DEMO == DEMO_RECORD
+	DemoStartRecording();
+#elif DEMO == DEMO_PLAYBACK
+	DemoStartPlayback();
+#endif
 	
-	srand((unsigned)time(NULL));
+#if KERNEL_BENCH
+	BenchKernels();
+#endif
 	
-	for (uint32_t i = 0; i < 120; i++)
-		bloodSpeed[i] = rand() % 4 + 2;
+#if PROFILER
+	ProfileInit();
+#elif DYNAMIC_RESOLUTION
+	ProfileStartClock();
+#endif
+	
+	ticks = count - 1;
 	
 	while (1)
 	{
-		scanKeys();
-		Update();
+#if PROFILER
+		ProfileBegin();
+#endif
+#if DYNAMIC_RESOLUTION
+		uint32_t frameStart = ProfileClock();
+#endif
+		uint32_t vblanks = count;
+		uint32_t pending = vblanks - ticks;
+		
+		if (pending > MAX_TICKS)
+			pending = MAX_TICKS;
+		
+		ticks = vblanks;
+		
+		// keys are scanned every tick so a press is only seen by one of them
+		while (pending--)
+		{
+			ReadInput();
+			Update();
+			DemoEndTick();
+#if PROFILER
+			if (inputDown & KEY_B)
+				profileOverlay = !profileOverlay;
+#endif
+		}
+		
+		PROFILE_MARK(PROFILE_UPDATE);
 		Render();
+#if DYNAMIC_RESOLUTION
+		ResolutionUpdate(ProfileClock() - frameStart);
+#endif
+#if PROFILER
+		// the next frame cannot copy columns the overlay drew over
+		if (ProfileDrawOverlay(yTable[page][0] + PROFILE_OVERLAY_ROW * VIEW_STRIDE + xTable[0]) && PROFILE_OVERLAY_ROW == 0)
+			interlaceValid = 0;
+		PROFILE_MARK(PROFILE_HUD);
+#endif
+#if TRIPLE_BUFFER
+		// queue the page for the next VBlank and go on in the one neither
+		// shown nor queued, replacing a queued page that was not shown yet,
+		// but never draw two frames in one tick
+		REG_IME = 0;
+		HudQueue();
+		queuedPage = page;
+		page = 3 - shownPage - page;
+		REG_IME = 1;
+		
+		while (count == vblanks)
+			VBlankIntrWait();
+		
+		PROFILE_MARK(PROFILE_VBLANK);
+#else
 		VBlankIntrWait();
-		page = !page;
-		REG_DISPCNT ^= BACKBUFFER;
+		FlipPage();
+		PROFILE_MARK(PROFILE_VBLANK);
+#endif
+#if PROFILER
+		ProfileEndFrame();
+#endif
 		//count = count & 3;
 		//vid_mem[(144 * SCREEN_WIDTH + 120) / 2] = count << 8 | count;
 		//vid_mem[(145 * SCREEN_WIDTH + 120) / 2] = count << 8 | count;
-		count = 0;
 	}
-}
\ No newline at end of file
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,193 @@
+// Eternal Horror
+// Copyright(C) 2020 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#include <gba_base.h>
+#include <gba_video.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "debug.h"
+#include "kernels.h"
+#include "profile.h"
+
+#ifdef HOST
+#include <time.h>
+#else
+#include <gba_timers.h>
+#endif
+
+// The cycle clock is also used by the timedemo, see timedemo.h, so it is
+// built without PROFILER as well
+void ProfileStartClock()
+{
+#ifndef HOST
+	REG_TM2CNT_H = 0;
+	REG_TM3CNT_H = 0;
+	REG_TM2CNT_L = 0;
+	REG_TM3CNT_L = 0;
+	REG_TM3CNT_H = TIMER_START | TIMER_COUNT;
+	REG_TM2CNT_H = TIMER_START;
+#endif
+}
+
+uint32_t ProfileClock()
+{
+#ifdef HOST
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 16777216 + (uint64_t) ts.tv_nsec * 16777216 / 1000000000;
+#else
+	uint32_t high;
+	uint32_t low;
+	
+	// timer 3 can tick over between the two reads
+	do
+	{
+		high = REG_TM3CNT_L;
+		low = REG_TM2CNT_L;
+	} while (high != REG_TM3CNT_L);
+	
+	return high << 16 | low;
+#endif
+}
+
+#if PROFILER
+
+// 3x5 glyphs, top row in the high bits
+const uint16_t digitGlyphs[10] = { 0x7B6F, 0x2C97, 0x73E7, 0x73CF, 0x5BC9, 0x79CF, 0x79EF, 0x7249, 0x7BEF, 0x7BCF };
+const uint16_t stageGlyphs[PROFILE_STAGES] = { 0x5B6F, 0x6BAD, 0x6BA4, 0x388E, 0x5BED, 0x5B6A };
+
+// The stages are spread across the view, 20 pixels apart in the default 120,
+// but no closer than the 16 a letter and three digits take
+#define PROFILE_STAGE_WIDTH (VIEW_WIDTH / PROFILE_STAGES < 16 ? 16 : VIEW_WIDTH / PROFILE_STAGES)
+
+profile_t profileFrames[PROFILE_FRAMES] EWRAM_BSS;
+uint32_t profileFrame = 0;
+uint32_t profileOverlay = 0;
+
+profile_t profileCurrent;
+uint32_t profileSums[PROFILE_STAGES];
+uint32_t profileLast = 0;
+uint32_t profileClear = 0;
+uint8_t profileColor = 0;
+
+void ProfileInit()
+{
+	ProfileStartClock();
+	
+	// the overlay is drawn in the brightest colour of the palette
+	uint32_t brightest = 0;
+	
+	for (uint32_t i = 0; i < 256; i++)
+	{
+		uint32_t color = BG_COLORS[i];
+		uint32_t value = (color & 31) + ((color >> 5) & 31) + ((color >> 10) & 31);
+		
+		if (value > brightest)
+		{
+			brightest = value;
+			profileColor = i;
+		}
+	}
+	
+	DebugLog("frame,update,rays,planes,sprites,hud,vblank");
+	ProfileBegin();
+}
+
+void ProfileBegin()
+{
+	profileLast = ProfileClock();
+}
+
+void ProfileMark(uint32_t stage)
+{
+	uint32_t now = ProfileClock();
+	profileCurrent.cycles[stage] += now - profileLast;
+	profileLast = now;
+}
+
+void ProfileEndFrame()
+{
+	profile_t *frame = &profileFrames[profileFrame % PROFILE_FRAMES];
+	uint32_t *cycles = profileCurrent.cycles;
+	
+	for (uint32_t i = 0; i < PROFILE_STAGES; i++)
+		profileSums[i] += cycles[i] - frame->cycles[i];
+	
+	*frame = profileCurrent;
+	cycles = frame->cycles;
+	memset(&profileCurrent, 0, sizeof(profileCurrent));
+	
+	DebugLog("%lu,%lu,%lu,%lu,%lu,%lu,%lu", (unsigned long) profileFrame, (unsigned long) cycles[0], (unsigned long) cycles[1],
+		(unsigned long) cycles[2], (unsigned long) cycles[3], (unsigned long) cycles[4], (unsigned long) cycles[5]);
+	
+	profileFrame++;
+}
+
+static uint16_t *DrawGlyph(uint16_t *p, uint32_t glyph, uint16_t pixel, uint16_t background)
+{
+	for (uint32_t y = 0; y < 5; y++)
+	{
+		for (uint32_t x = 0; x < 3; x++)
+			PUT_PIXEL(p + y * VIEW_STRIDE + x, glyph & (0x4000 >> (y * 3 + x)) ? pixel : background);
+	}
+	
+	return p + 4;
+}
+
+// p is the first pixel of the eight border rows under the view, with the
+// same layout as a view row. Each stage takes PROFILE_STAGE_WIDTH pixels: its
+// letter and up to three digits. Returns whether it drew anything.
+uint32_t ProfileDrawOverlay(uint16_t *p)
+{
+	uint16_t pixel = PIXEL(profileColor);
+	uint16_t background = PIXEL(0x00);
+	
+	if (!profileOverlay)
+	{
+		// clear both pages once when turned off
+		if (profileClear)
+		{
+			for (uint32_t i = 0; i < 8 * VIEW_STRIDE; i += VIEW_STRIDE)
+			{
+				for (uint32_t x = 0; x < VIEW_WIDTH; x++)
+					PUT_PIXEL(p + i + x, background);
+			}
+			
+			profileClear--;
+			return 1;
+		}
+		
+		return 0;
+	}
+	
+	profileClear = 2;
+	p += VIEW_STRIDE;
+	
+	for (uint32_t i = 0; i < PROFILE_STAGES; i++)
+	{
+		uint32_t kilocycles = profileSums[i] / (PROFILE_FRAMES * 1000);
+		uint16_t *q = DrawGlyph(p + i * PROFILE_STAGE_WIDTH, stageGlyphs[i], pixel, background);
+		
+		if (kilocycles > 999)
+			kilocycles = 999;
+		
+		q = DrawGlyph(q, kilocycles >= 100 ? digitGlyphs[kilocycles / 100] : 0, pixel, background);
+		q = DrawGlyph(q, kilocycles >= 10 ? digitGlyphs[kilocycles / 10 % 10] : 0, pixel, background);
+		DrawGlyph(q, digitGlyphs[kilocycles % 10], pixel, background);
+	}
+	
+	return 1;
+}
+
+#endif
@@ -0,0 +1,279 @@
+// Eternal Horror
+// Copyright(C) 2020 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+#include <stdint.h>
+
+#include "debug.h"
+#include "demo.h"
+#include "fixed.h"
+#include "profile.h"
+#include "timedemo.h"
+
+// Game state, from main.c
+extern uint32_t level;
+extern const uint32_t numLevels;
+extern uint32_t state;
+extern int32_t health;
+extern fixed_t cameraX;
+extern fixed_t cameraY;
+extern angle_t cameraAngle;
+
+void NextLevel();
+void Update();
+void Render();
+void FlipPage();
+
+// A door opens 30 tics after the camera stops next to it and slides open in 15
+#define DOOR 48
+
+// Paths: the camera moves from one waypoint's cell centre and angle to the
+// next over its tics, 8 tics a cell and 16 a quarter turn as when played.
+// Angles are not wrapped, so 512 more is a full turn to the left.
+
+const waypoint_t level1Path[] =
+{
+	{ 1, 2, 0, 0 }, { 1, 2, 512, 64 },
+	{ 2, 2, 512, 8 }, { 2, 2, 512, DOOR },
+	{ 6, 2, 512, 32 }, { 6, 2, 512, DOOR },
+	{ 11, 2, 512, 40 }, { 11, 2, 512, DOOR },
+	{ 14, 2, 512, 24 }, { 14, 2, 384, 16 },
+	{ 14, 3, 384, 8 }, { 14, 3, 384, DOOR },
+	{ 14, 8, 384, 40 }, { 14, 8, 384, DOOR },
+	{ 14, 10, 384, 16 }, { 14, 10, 896, 64 },
+	{ 14, 11, 896, 8 }, { 14, 11, 1024, 16 },
+	{ 15, 11, 1024, 8 }, { 15, 11, 1024, DOOR },
+	{ 20, 11, 1024, 40 }, { 20, 11, 1024, DOOR },
+	{ 23, 11, 1024, 24 }, { 23, 11, 1280, 32 }, { 23, 11, 1152, 16 },
+	{ 23, 10, 1152, 8 }, { 23, 10, 1152, DOOR },
+	{ 23, 8, 1152, 16 }, { 23, 8, 1664, 64 }
+};
+
+const waypoint_t level2Path[] =
+{
+	{ 2, 15, 64, 0 }, { 2, 15, 128, 8 },
+	{ 2, 14, 128, 8 }, { 2, 14, 128, DOOR },
+	{ 2, 11, 128, 24 }, { 2, 11, 640, 64 }, { 2, 11, 512, 16 },
+	{ 3, 11, 512, 8 }, { 3, 11, 512, DOOR },
+	{ 8, 11, 512, 40 }, { 8, 11, 512, DOOR },
+	{ 11, 11, 512, 24 }, { 11, 11, 640, 16 },
+	{ 11, 10, 640, 8 }, { 11, 10, 640, DOOR },
+	{ 11, 5, 640, 40 }, { 11, 5, 640, DOOR },
+	{ 11, 2, 640, 24 }, { 11, 2, 1152, 64 }, { 11, 2, 1024, 16 },
+	{ 12, 2, 1024, 8 }, { 12, 2, 1024, DOOR },
+	{ 17, 2, 1024, 40 }, { 17, 2, 1024, DOOR },
+	{ 20, 2, 1024, 24 }, { 20, 2, 896, 16 },
+	{ 20, 3, 896, 8 }, { 20, 3, 896, DOOR },
+	{ 20, 8, 896, 40 }, { 20, 8, 896, DOOR },
+	{ 20, 11, 896, 24 }, { 20, 11, 1024, 16 },
+	{ 21, 11, 1024, 8 }, { 21, 11, 1024, DOOR },
+	{ 23, 11, 1024, 16 }, { 23, 11, 1280, 32 }
+};
+
+const waypoint_t level3Path[] =
+{
+	{ 1, 2, 0, 0 },
+	{ 2, 2, 0, 8 }, { 2, 2, 0, DOOR },
+	{ 5, 2, 0, 24 }, { 5, 2, 512, 64 },
+	{ 6, 2, 512, 8 }, { 6, 2, 512, DOOR },
+	{ 11, 2, 512, 40 }, { 11, 2, 512, DOOR },
+	{ 14, 2, 512, 24 }, { 14, 2, 384, 16 },
+	{ 14, 3, 384, 8 }, { 14, 3, 384, DOOR },
+	{ 14, 8, 384, 40 }, { 14, 8, 384, DOOR },
+	{ 14, 11, 384, 24 }, { 14, 11, 256, 16 },
+	{ 13, 11, 256, 8 }, { 13, 11, 256, DOOR },
+	{ 8, 11, 256, 40 }, { 8, 11, 256, DOOR },
+	{ 5, 11, 256, 24 }, { 5, 11, 768, 64 }, { 5, 11, 896, 16 },
+	{ 5, 12, 896, 8 }, { 5, 12, 896, DOOR },
+	{ 5, 17, 896, 40 }, { 5, 17, 896, DOOR },
+	{ 5, 20, 896, 24 }, { 5, 20, 1024, 16 },
+	{ 6, 20, 1024, 8 }, { 6, 20, 1024, DOOR },
+	{ 11, 20, 1024, 40 }, { 11, 20, 1024, DOOR },
+	{ 14, 20, 1024, 24 }, { 14, 20, 896, 16 },
+	{ 14, 21, 896, 8 }, { 14, 21, 896, DOOR },
+	{ 14, 23, 896, 16 }, { 14, 23, 1408, 64 }
+};
+
+const waypoint_t level4Path[] =
+{
+	{ 2, 1, 0, 0 }, { 2, 1, -128, 16 },
+	{ 2, 2, -128, 8 }, { 2, 2, -128, DOOR },
+	{ 2, 5, -128, 24 }, { 2, 5, 384, 64 }, { 2, 5, 512, 16 },
+	{ 3, 5, 512, 8 }, { 3, 5, 512, DOOR },
+	{ 8, 5, 512, 40 }, { 8, 5, 512, DOOR },
+	{ 11, 5, 512, 24 }, { 11, 5, 384, 16 },
+	{ 11, 6, 384, 8 }, { 11, 6, 384, DOOR },
+	{ 11, 11, 384, 40 }, { 11, 11, 384, DOOR },
+	{ 11, 14, 384, 24 }, { 11, 14, 896, 64 },
+	{ 11, 15, 896, 8 }, { 11, 15, 896, DOOR },
+	{ 11, 20, 896, 40 }, { 11, 20, 896, DOOR },
+	{ 11, 23, 896, 24 }, { 11, 23, 1024, 16 },
+	{ 12, 23, 1024, 8 }, { 12, 23, 1024, DOOR },
+	{ 17, 23, 1024, 40 }, { 17, 23, 1024, DOOR },
+	{ 21, 23, 1024, 32 }, { 21, 23, 1024, DOOR },
+	{ 26, 23, 1024, 40 }, { 26, 23, 1024, DOOR },
+	{ 29, 23, 1024, 24 }, { 29, 23, 1536, 64 },
+	{ 32, 23, 1536, 24 }, { 32, 23, 1536, DOOR },
+	{ 34, 23, 1536, 16 }, { 34, 23, 1792, 32 }
+};
+
+const struct
+{
+	const waypoint_t *waypoints;
+	uint32_t count;
+} paths[] =
+{
+	{ level1Path, sizeof(level1Path) / sizeof(waypoint_t) },
+	{ level2Path, sizeof(level2Path) / sizeof(waypoint_t) },
+	{ level3Path, sizeof(level3Path) / sizeof(waypoint_t) },
+	{ level4Path, sizeof(level4Path) / sizeof(waypoint_t) }
+};
+
+typedef struct
+{
+	uint32_t cycles;
+	uint32_t frame;
+	int32_t x;
+	int32_t y;
+	angle_t angle;
+} timedemoframe_t;
+
+typedef struct
+{
+	uint32_t frames;
+	uint32_t min;
+	uint32_t max;
+	uint64_t total;
+	timedemoframe_t worst[TIMEDEMO_WORST];
+} timedemo_t;
+
+timedemo_t timedemoLevels[sizeof(paths) / sizeof(paths[0])];
+
+// Cell centre a to cell centre b in map units, t tics of tics along
+static fixed_t Lerp(int32_t a, int32_t b, uint32_t t, uint32_t tics)
+{
+	int64_t from = (a * 64 + 32) << FRACBITS;
+	int64_t to = (b * 64 + 32) << FRACBITS;
+	return from + (to - from) * t / tics;
+}
+
+static void SetCamera(fixed_t x, fixed_t y, angle_t angle)
+{
+	cameraX = x;
+	cameraY = y;
+	cameraAngle = angle;
+}
+
+// The camera is put back on the path after Update(), whose collision pushes
+// it out of enemy cells the path flies through
+static void TimeFrame(timedemo_t *result, fixed_t x, fixed_t y, angle_t angle)
+{
+	health = 100;
+	inputHeld = 0;
+	inputDown = 0;
+	
+	uint32_t start = ProfileClock();
+	SetCamera(x, y, angle);
+	Update();
+	SetCamera(x, y, angle);
+	Render();
+	uint32_t cycles = ProfileClock() - start;
+	
+	FlipPage();
+	
+	if (cycles < result->min)
+		result->min = cycles;
+	
+	if (cycles > result->max)
+		result->max = cycles;
+	
+	result->total += cycles;
+	
+	// keep the slowest frames in order, slowest first
+	int32_t i = TIMEDEMO_WORST - 1;
+	
+	if (cycles > result->worst[i].cycles)
+	{
+		for (; i > 0 && cycles > result->worst[i - 1].cycles; i--)
+			result->worst[i] = result->worst[i - 1];
+		
+		timedemoframe_t *frame = &result->worst[i];
+		frame->cycles = cycles;
+		frame->frame = result->frames;
+		frame->x = cameraX >> FRACBITS;
+		frame->y = cameraY >> FRACBITS;
+		frame->angle = cameraAngle;
+	}
+	
+	result->frames++;
+}
+
+static void RunPath(const waypoint_t *waypoints, uint32_t count, timedemo_t *result)
+{
+	result->min = UINT32_MAX;
+	
+	for (uint32_t i = 1; i < count; i++)
+	{
+		const waypoint_t *from = &waypoints[i - 1];
+		const waypoint_t *to = &waypoints[i];
+		
+		for (uint32_t t = 1; t <= to->tics; t++)
+		{
+			fixed_t x = Lerp(from->gridX, to->gridX, t, to->tics);
+			fixed_t y = Lerp(from->gridY, to->gridY, t, to->tics);
+			angle_t angle = (from->angle + (to->angle - from->angle) * (int32_t) t / (int32_t) to->tics) & ANGLESMASK;
+			TimeFrame(result, x, y, angle);
+		}
+	}
+}
+
+void Timedemo()
+{
+	uint32_t numPaths = sizeof(paths) / sizeof(paths[0]);
+	
+	if (numPaths > numLevels)
+		numPaths = numLevels;
+	
+	for (uint32_t i = 0; i < numPaths; i++)
+	{
+		const waypoint_t *start = &paths[i].waypoints[0];
+		
+		level = i;
+		state = 1;
+		NextLevel();
+		
+		SetCamera((start->gridX * 64 + 32) << FRACBITS, (start->gridY * 64 + 32) << FRACBITS, start->angle & ANGLESMASK);
+		
+		RunPath(paths[i].waypoints, paths[i].count, &timedemoLevels[i]);
+	}
+	
+	DebugLog("level,frames,min,avg,max");
+	
+	for (uint32_t i = 0; i < numPaths; i++)
+	{
+		timedemo_t *result = &timedemoLevels[i];
+		DebugLog("%lu,%lu,%lu,%lu,%lu", (unsigned long) i + 1, (unsigned long) result->frames, (unsigned long) result->min,
+			(unsigned long) (result->total / result->frames), (unsigned long) result->max);
+	}
+	
+	DebugLog("level,rank,frame,cycles,x,y,angle");
+	
+	for (uint32_t i = 0; i < numPaths; i++)
+	{
+		for (uint32_t j = 0; j < TIMEDEMO_WORST; j++)
+		{
+			timedemoframe_t *frame = &timedemoLevels[i].worst[j];
+			DebugLog("%lu,%lu,%lu,%lu,%ld,%ld,%lu", (unsigned long) i + 1, (unsigned long) j + 1, (unsigned long) frame->frame,
+				(unsigned long) frame->cycles, (long) frame->x, (long) frame->y, (unsigned long) frame->angle);
+		}
+	}
+}
@@ -0,0 +1,358 @@
+// Eternal Horror
+// Copyright(C) 2020 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// Generates the compiled wall scalers, see scalers.h. Usage:
+//
+//   mkscalers arm <budget> <file> [profile]   ARM assembly for the GBA build
+//   mkscalers c <budget> <file> [profile]     C for the host build
+//
+// Every wall height is even, so there is one scaler per height from 2 to
+// MAX_HEIGHT, for the view of view.h, which the build passes its DEFINES to.
+// A scaler draws the visible part of a 64 texel column at that height as
+// straight-line code with the texture offsets worked out here: one load per
+// distinct texel and two stores per row pair. Heights whose ARM code fits in
+// <budget> bytes of IWRAM get a scaler, the rest have no entry and use
+// DrawWallColumn. Both outputs cover the same heights so the host draws what
+// the GBA draws.
+//
+// The profile is how many wall columns were drawn at each height, as ./bench
+// -w writes it, and the heights are picked by the cycles their scalers save
+// per byte over the profile, so the budget goes to the walls that take the
+// most time: mostly the ones taller than the view, which draw every row of
+// it. Without a profile the heights are taken from the smallest up.
+//
+// The output has a mode 4 and a mode 5 set of scalers, each unlit and lit,
+// picked by COMPACT_FRAMEBUFFER and LIGHTING in kernels.h. Mode 5 scalers
+// look each texel up in colorTable and store one halfword per row. Lit
+// scalers look it up in lightTable instead: in mode 5 that costs only the
+// load of the table pointer, in mode 4 one more ldrb per distinct texel, so
+// fewer heights fit the budget.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "view.h"
+
+static const char *modeNames[2][2] = { { "mode 4", "mode 5" }, { "lit mode 4", "lit mode 5" } };
+static const char *sections[4] = { "#if LIGHTING && !COMPACT_FRAMEBUFFER", "#elif LIGHTING", "#elif !COMPACT_FRAMEBUFFER", "#else" };
+static const uint32_t rowBytes[2] = { 240, 320 };
+
+// texel offset of every row of a column of the given height, as DrawWallSlice
+// works them out with scalarTable[(MAX_HEIGHT - height) >> 1] = 2^22 / height
+static uint32_t TexelOffsets(uint32_t height, uint32_t *offsets)
+{
+	uint32_t scalar = (1 << 22) / height;
+	int32_t wallY = (VIEW_HEIGHT - (int32_t)height) >> 1;
+	uint32_t textureOffsetY = wallY < 0 ? -wallY * scalar : 0;
+	uint32_t rows = height < VIEW_HEIGHT ? height : VIEW_HEIGHT;
+
+	for (uint32_t i = 0; i < rows; i++)
+		offsets[i] = (textureOffsetY + i * scalar) >> 16;
+
+	return rows;
+}
+
+// Bytes of ARM code in the scaler for the given height
+static uint32_t ScalerSize(uint32_t lit, uint32_t compact, uint32_t height)
+{
+	uint32_t offsets[VIEW_HEIGHT];
+	uint32_t rows = TexelOffsets(height, offsets);
+	uint32_t size = compact ? 4 + lit : 1 + lit * 3;
+
+	for (uint32_t i = 0; i < rows; i++)
+	{
+		if (i == 0 || offsets[i] != offsets[i - 1])
+			size += compact ? 3 : 2 + lit;
+
+		size += compact ? 1 : 2;
+	}
+
+	return size * 4;
+}
+
+// Cycles a call of the scaler for the given height saves over
+// DrawWallColumnArm, counting a load 3 cycles, a store 2 and anything else
+// 1. The loop spends 9 cycles a row in mode 4 (12 lit) and 10 in mode 5,
+// and 4 more every four rows on its subs and branch; the scaler only the
+// stores and each distinct texel's load and lookup.
+static uint32_t ScalerSaving(uint32_t lit, uint32_t compact, uint32_t height)
+{
+	uint32_t offsets[VIEW_HEIGHT];
+	uint32_t rows = TexelOffsets(height, offsets);
+	uint32_t loop = rows * (compact ? 10 : 9 + lit * 3) + rows / 4 * 4;
+	uint32_t scaler = 0;
+
+	for (uint32_t i = 0; i < rows; i++)
+	{
+		if (i == 0 || offsets[i] != offsets[i - 1])
+			scaler += compact ? 7 : 4 + lit * 3;
+
+		scaler += compact ? 2 : 4;
+	}
+
+	return loop > scaler ? loop - scaler : 0;
+}
+
+// Wall columns per height from the profile, by height >> 1. The profile is
+// taken at VIEW_SCALE 2, where walls are half as tall as at 1.
+static double profile[(MAX_HEIGHT >> PROJECTION_SHIFT) / 2 + 1];
+static uint32_t profiled = 0;
+
+static int LoadProfile(const char *path)
+{
+	FILE *file = fopen(path, "r");
+	char line[128];
+
+	if (!file)
+		return 0;
+
+	while (fgets(line, sizeof(line), file))
+	{
+		unsigned height;
+		double columns;
+
+		if (line[0] == '#' || sscanf(line, "%u %lf", &height, &columns) != 2)
+			continue;
+
+		if (height >= 2 && height <= MAX_HEIGHT >> PROJECTION_SHIFT)
+			profile[height >> 1] += columns;
+	}
+
+	fclose(file);
+	profiled = 1;
+	return 1;
+}
+
+// Picks the heights to compile, into selected by height >> 1, and returns
+// the bytes they take
+static uint32_t SelectHeights(uint32_t lit, uint32_t compact, uint32_t budget, uint8_t *selected)
+{
+	double value[MAX_HEIGHT / 2 + 1];
+	uint32_t used = 0;
+
+	memset(selected, 0, MAX_HEIGHT / 2 + 1);
+
+	if (!profiled)
+	{
+		for (uint32_t height = 2; height <= MAX_HEIGHT && used + ScalerSize(lit, compact, height) <= budget; height += 2)
+		{
+			selected[height >> 1] = 1;
+			used += ScalerSize(lit, compact, height);
+		}
+
+		return used;
+	}
+
+	for (uint32_t height = 2; height <= MAX_HEIGHT; height += 2)
+	{
+		uint32_t profileHeight = (height >> PROJECTION_SHIFT) & ~1u;
+		double columns = profile[(profileHeight < 2 ? 2 : profileHeight) >> 1];
+
+		value[height >> 1] = columns * ScalerSaving(lit, compact, height) / ScalerSize(lit, compact, height);
+	}
+
+	// the most cycles saved per byte that still fits, until nothing does
+	while (1)
+	{
+		uint32_t best = 0;
+
+		for (uint32_t height = 2; height <= MAX_HEIGHT; height += 2)
+		{
+			if (!selected[height >> 1] && value[height >> 1] > 0 && used + ScalerSize(lit, compact, height) <= budget && (best == 0 || value[height >> 1] > value[best >> 1]))
+				best = height;
+		}
+
+		if (best == 0)
+			return used;
+
+		selected[best >> 1] = 1;
+		used += ScalerSize(lit, compact, best);
+	}
+}
+
+// Mode 4: r0 = p, r1 = texture, r2 = texel, r12 = lightTable when lit
+// Mode 5: r0 = p, r1 = texture, r2 = colour, r3 = row bytes, r12 = colorTable
+// or lightTable
+static void WriteArm(FILE *file, uint32_t lit, uint32_t compact, uint32_t height)
+{
+	uint32_t offsets[VIEW_HEIGHT];
+	uint32_t rows = TexelOffsets(height, offsets);
+
+	fprintf(file, "\n\t.type Scaler%u, %%function\nScaler%u:\n", height, height);
+
+	if (compact || lit)
+		fprintf(file, "\tldr\tr12, 1f\n");
+
+	if (lit)
+		fprintf(file, "\tldr\tr12, [r12]\n");
+
+	if (compact)
+		fprintf(file, "\tmov\tr3, #%u\n", rowBytes[compact]);
+
+	for (uint32_t i = 0; i < rows; i++)
+	{
+		if (i == 0 || offsets[i] != offsets[i - 1])
+		{
+			fprintf(file, "\tldrb\tr2, [r1, #%u]\n", offsets[i]);
+
+			if (compact)
+			{
+				fprintf(file, "\tadd\tr2, r12, r2, lsl #1\n");
+				fprintf(file, "\tldrh\tr2, [r2]\n");
+			}
+			else
+			{
+				if (lit)
+					fprintf(file, "\tldrb\tr2, [r12, r2]\n");
+
+				fprintf(file, "\torr\tr2, r2, r2, lsl #8\n");
+			}
+		}
+
+		if (compact)
+			fprintf(file, "\tstrh\tr2, [r0], r3\n");
+		else
+		{
+			fprintf(file, "\tstrh\tr2, [r0], #%u\n", rowBytes[compact]);
+			fprintf(file, "\tstrh\tr2, [r0], #%u\n", rowBytes[compact]);
+		}
+	}
+
+	fprintf(file, "\tbx\tlr\n");
+
+	if (compact || lit)
+		fprintf(file, "1:\n\t.word %s\n", lit ? "lightTable" : "colorTable");
+
+	fprintf(file, "\t.size Scaler%u, . - Scaler%u\n", height, height);
+}
+
+static void WriteC(FILE *file, uint32_t compact, uint32_t height)
+{
+	uint32_t offsets[VIEW_HEIGHT];
+	uint32_t rows = TexelOffsets(height, offsets);
+	uint32_t rowHalfwords = rowBytes[compact] / 2;
+
+	fprintf(file, "\nstatic void Scaler%u(uint16_t *p, const uint8_t *texture)\n{\n\tuint16_t color;\n", height);
+
+	for (uint32_t i = 0; i < rows; i++)
+	{
+		if (i == 0 || offsets[i] != offsets[i - 1])
+			fprintf(file, "\tcolor = LIGHT_PIXEL(texture[%u]);\n", offsets[i]);
+
+		if (compact)
+			fprintf(file, "\tp[%u] = color;\n", i * rowHalfwords);
+		else
+			fprintf(file, "\tp[%u] = color;\n\tp[%u] = color;\n", i * 2 * rowHalfwords, (i * 2 + 1) * rowHalfwords);
+	}
+
+	fprintf(file, "}\n");
+}
+
+static void WriteTable(FILE *file, uint32_t arm, const uint8_t *selected)
+{
+	if (arm)
+		fprintf(file, "\n\t.section .rodata\n\t.align 2\n\t.global scalerTable\n\t.type scalerTable, %%object\nscalerTable:\n");
+	else
+		fprintf(file, "\nconst scaler_t scalerTable[%u] =\n{\n", MAX_HEIGHT / 2 + 1);
+
+	for (uint32_t height = 0; height <= MAX_HEIGHT; height += 2)
+	{
+		if (selected[height >> 1])
+			fprintf(file, arm ? "\t.word Scaler%u\n" : "\tScaler%u,\n", height);
+		else
+			fprintf(file, arm ? "\t.word 0\n" : "\tNULL,\n");
+	}
+
+	fprintf(file, arm ? "\t.size scalerTable, . - scalerTable\n" : "};\n");
+}
+
+int main(int argc, char **argv)
+{
+	if ((argc != 4 && argc != 5) || (strcmp(argv[1], "arm") && strcmp(argv[1], "c")))
+	{
+		fprintf(stderr, "usage: mkscalers arm|c <budget> <file> [profile]\n");
+		return 1;
+	}
+
+	if (argc == 5 && !LoadProfile(argv[4]))
+	{
+		perror(argv[4]);
+		return 1;
+	}
+
+	uint32_t arm = !strcmp(argv[1], "arm");
+	uint32_t budget = strtoul(argv[2], NULL, 0);
+	const char *comment = arm ? "@" : "//";
+	FILE *file = fopen(argv[3], "w");
+
+	if (!file)
+	{
+		perror(argv[3]);
+		return 1;
+	}
+
+	fprintf(file, "%s Generated by tools/mkscalers.c, do not edit\n", comment);
+	if (arm)
+		fprintf(file, "\n#include \"kernels.h\"\n");
+	else
+		fprintf(file, "\n#include <stddef.h>\n#include <stdint.h>\n\n#include \"kernels.h\"\n#include \"scalers.h\"\n");
+
+	for (uint32_t section = 0; section < 4; section++)
+	{
+		uint32_t lit = section < 2;
+		uint32_t compact = section & 1;
+		uint8_t selected[MAX_HEIGHT / 2 + 1];
+		uint32_t used = SelectHeights(lit, compact, budget, selected);
+		uint32_t count = 0;
+		uint32_t lowest = 0;
+		uint32_t highest = 0;
+
+		for (uint32_t height = 2; height <= MAX_HEIGHT; height += 2)
+		{
+			if (selected[height >> 1])
+			{
+				count++;
+				lowest = lowest ? lowest : height;
+				highest = height;
+			}
+		}
+
+		fprintf(file, "\n%s\n", sections[section]);
+		fprintf(file, "\n%s %s: %u heights from %u to %u, %u of %u bytes of IWRAM\n", comment, modeNames[lit][compact], count, lowest, highest, used, budget);
+
+		if (arm)
+			fprintf(file, "\n\t.section .iwram, \"ax\", %%progbits\n\t.arm\n\t.align 2\n");
+
+		for (uint32_t height = 2; height <= MAX_HEIGHT; height += 2)
+		{
+			if (!selected[height >> 1])
+				continue;
+
+			if (arm)
+				WriteArm(file, lit, compact, height);
+			else
+				WriteC(file, compact, height);
+		}
+
+		WriteTable(file, arm, selected);
+
+		printf("scalers: %s %u heights from %u to %u compiled, %u of %u bytes of IWRAM\n", modeNames[lit][compact], count, lowest, highest, used, budget);
+	}
+
+	fprintf(file, "\n#endif\n");
+	fclose(file);
+
+	return 0;
+}
@@ -0,0 +1,143 @@
+// Eternal Horror
+// Copyright(C) 2020 John D. Corrado
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// Generates the run-length encoded sprites, see sprites.h. Usage:
+//
+//   mksprites <bitmap> <file>
+//
+// <bitmap> is graphicsBitmap as raw 8-bit palette indices, which grit writes
+// with -ftb for the GBA build and host/mkdata.c next to graphics.c for the
+// host build, so the runs match the palette either build was quantized to.
+// <file> is C with the column, run and texel tables. The size of the tables
+// against the raw frames is printed.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "sprites.h"
+
+static uint8_t *ReadFile(const char *path, size_t *size)
+{
+	FILE *file = fopen(path, "rb");
+
+	if (!file)
+	{
+		perror(path);
+		exit(1);
+	}
+
+	fseek(file, 0, SEEK_END);
+	*size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	uint8_t *data = malloc(*size);
+
+	if (fread(data, 1, *size, file) != *size)
+	{
+		perror(path);
+		exit(1);
+	}
+
+	fclose(file);
+	return data;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc != 3)
+	{
+		fprintf(stderr, "usage: mksprites <bitmap> <file>\n");
+		return 1;
+	}
+
+	size_t size;
+	uint8_t *bitmap = ReadFile(argv[1], &size);
+
+	if (size < SPRITE_OFFSET + SPRITE_FRAMES * 4096)
+	{
+		fprintf(stderr, "%s: too small for %u sprite frames\n", argv[1], SPRITE_FRAMES);
+		return 1;
+	}
+
+	static uint16_t columns[SPRITE_FRAMES * 65];
+	static spriterun_t runs[SPRITE_FRAMES * 64 * 32];
+	static uint8_t texels[SPRITE_FRAMES * 4096];
+	uint32_t numRuns = 0;
+	uint32_t numTexels = 0;
+
+	for (uint32_t f = 0; f < SPRITE_FRAMES; f++)
+	{
+		for (uint32_t c = 0; c < 64; c++)
+		{
+			const uint8_t *column = &bitmap[SPRITE_OFFSET + f * 4096 + c * 64];
+			columns[f * 65 + c] = numRuns;
+
+			for (uint32_t y = 0; y < 64; y++)
+			{
+				if (column[y] == SPRITE_COLOR_KEY)
+					continue;
+
+				spriterun_t *run = &runs[numRuns++];
+				run->start = y;
+				run->length = 0;
+				run->texel = numTexels;
+
+				while (y < 64 && column[y] != SPRITE_COLOR_KEY)
+				{
+					texels[numTexels++] = column[y++];
+					run->length++;
+				}
+			}
+		}
+
+		columns[f * 65 + 64] = numRuns;
+	}
+
+	uint32_t rawBytes = SPRITE_FRAMES * 4096;
+	uint32_t bytes = sizeof(columns) + numRuns * sizeof(spriterun_t) + numTexels;
+	FILE *file = fopen(argv[2], "w");
+
+	if (!file)
+	{
+		perror(argv[2]);
+		return 1;
+	}
+
+	fprintf(file, "// Generated by tools/mksprites.c, do not edit\n");
+	fprintf(file, "\n#include <stdint.h>\n\n#include \"sprites.h\"\n");
+	fprintf(file, "\n// %u frames: %u runs, %u texels, %u of %u bytes\n", SPRITE_FRAMES, numRuns, numTexels, bytes, rawBytes);
+
+	fprintf(file, "\nconst uint16_t spriteColumns[%u] =\n{", SPRITE_FRAMES * 65);
+
+	for (uint32_t i = 0; i < SPRITE_FRAMES * 65; i++)
+		fprintf(file, "%s%u,", (i % 13) ? " " : "\n\t", columns[i]);
+
+	fprintf(file, "\n};\n\nconst spriterun_t spriteRuns[%u] =\n{", numRuns);
+
+	for (uint32_t i = 0; i < numRuns; i++)
+		fprintf(file, "%s{ %u, %u, %u },", (i & 3) ? " " : "\n\t", runs[i].start, runs[i].length, runs[i].texel);
+
+	fprintf(file, "\n};\n\nconst uint8_t spriteTexels[%u] =\n{", numTexels);
+
+	for (uint32_t i = 0; i < numTexels; i++)
+		fprintf(file, "%s%u,", (i & 15) ? " " : "\n\t", texels[i]);
+
+	fprintf(file, "\n};\n");
+	fclose(file);
+
+	printf("sprites: %u frames in %u runs, %u of %u bytes, %d saved\n", SPRITE_FRAMES, numRuns, bytes, rawBytes, (int32_t) (rawBytes - bytes));
+
+	free(bitmap);
+
+	return 0;
+}